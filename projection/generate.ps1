@@ -1,4 +1,4 @@
-param ([switch]$clean, [switch]$fullProjection, [switch]$useLocalPyWinRTNuget)
+param ([switch]$clean, [switch]$fullProjection, [switch]$useLocalPyWinRTNuget, [switch]$unity, [switch]$pch)
 
 $windows_sdk = 'sdk+'
 $repoRootPath = (get-item $PSScriptRoot).Parent.FullName
@@ -45,4 +45,12 @@ $pyout = $pyexclude | ForEach-Object { "-exclude", "$_" }
 
 $pyparams = ("-input", $windows_sdk, "-output", $pywinrt_path, "-verbose") + $pyin + $pyout
 
+if ($unity) {
+    $pyparams += "-unity"
+}
+
+if ($pch) {
+    $pyparams += "-pch"
+}
+
 & $pywinrt_exe $pyparams
@@ -0,0 +1,803 @@
+#include "pch.h"
+#include "helpers.h"
+
+#include "strings.h"
+#include "settings.h"
+#include "type_writers.h"
+#include "code_writers.h"
+#include "file_writers.h"
+#include "synthetic_winmd.h"
+
+namespace pywinrt
+{
+    settings_type settings;
+}
+
+namespace pywinrt::benchmark
+{
+    using clock = std::chrono::high_resolution_clock;
+
+    struct benchmark_options
+    {
+        synthetic_options metadata;
+        uint32_t iterations{5};
+        std::string filter;
+        std::vector<std::string> input;
+        std::filesystem::path output_folder{
+            std::filesystem::temp_directory_path() / "pywinrt_benchmark"};
+    };
+
+    struct usage_exception
+    {
+    };
+
+    // keeps the results of the benchmarks that don't write anything observable
+    volatile size_t sink;
+
+    void print_usage(writer& w)
+    {
+        w.write(R"(
+Usage: pywinrt_benchmark [options...]
+
+Options:
+
+  -namespaces <count>  Synthetic namespaces (default: %)
+  -classes <count>     Classes in each namespace (default: %)
+  -methods <count>     Methods on each interface (default: %)
+  -properties <count>  Properties on each interface (default: %)
+  -events <count>      Events on each interface (default: %)
+  -depth <count>       Interfaces in the hierarchy of each class (default: %)
+  -iterations <count>  Times to run each benchmark (default: %)
+  -filter <text>       Only run the benchmarks with <text> in their name
+  -input <path>        Use existing metadata instead of synthetic metadata
+  -include <prefix>    Namespace prefix to include when using -input
+  -output <path>       Folder for the metadata and the generated files
+
+Each benchmark prints the time of its first run, which includes filling the
+generator's caches, and the minimum and median time of all of its runs.
+)",
+                synthetic_options{}.namespaces,
+                synthetic_options{}.classes,
+                synthetic_options{}.methods,
+                synthetic_options{}.properties,
+                synthetic_options{}.events,
+                synthetic_options{}.depth,
+                benchmark_options{}.iterations);
+    }
+
+    benchmark_options parse_args(int const argc, char** argv)
+    {
+        benchmark_options options;
+
+        for (int i = 1; i < argc; i++)
+        {
+            std::string_view const arg{argv[i]};
+
+            auto value = [&]() -> std::string_view
+            {
+                if (i + 1 == argc)
+                {
+                    throw_invalid("Option '", arg, "' requires a value");
+                }
+
+                return argv[++i];
+            };
+
+            auto number = [&]
+            {
+                auto text = value();
+                uint32_t result{};
+                auto [end, ec]
+                    = std::from_chars(text.data(), text.data() + text.size(), result);
+
+                if (ec != std::errc{} || end != text.data() + text.size())
+                {
+                    throw_invalid("Option '", arg, "' requires a number");
+                }
+
+                return result;
+            };
+
+            if (arg == "-namespaces")
+            {
+                options.metadata.namespaces = number();
+            }
+            else if (arg == "-classes")
+            {
+                options.metadata.classes = number();
+            }
+            else if (arg == "-methods")
+            {
+                options.metadata.methods = number();
+            }
+            else if (arg == "-properties")
+            {
+                options.metadata.properties = number();
+            }
+            else if (arg == "-events")
+            {
+                options.metadata.events = number();
+            }
+            else if (arg == "-depth")
+            {
+                options.metadata.depth = number();
+            }
+            else if (arg == "-iterations")
+            {
+                options.iterations = std::max(number(), 1u);
+            }
+            else if (arg == "-filter")
+            {
+                options.filter = value();
+            }
+            else if (arg == "-input")
+            {
+                options.input.emplace_back(value());
+            }
+            else if (arg == "-include")
+            {
+                settings.include.emplace(value());
+            }
+            else if (arg == "-output")
+            {
+                options.output_folder = std::filesystem::absolute(value());
+            }
+            else
+            {
+                throw usage_exception{};
+            }
+        }
+
+        return options;
+    }
+
+    double get_elapsed_ms(clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    }
+
+    /**
+     * Runs @p body, which is passed the iteration number, the given number of
+     * times and prints its timings.
+     */
+    template<typename F>
+    void run_benchmark(
+        writer& w,
+        benchmark_options const& options,
+        std::string const& name,
+        F&& body)
+    {
+        if (name.find(options.filter) == std::string::npos)
+        {
+            return;
+        }
+
+        std::vector<double> times;
+
+        for (uint32_t i{}; i < options.iterations; i++)
+        {
+            auto start = clock::now();
+            body(i);
+            times.push_back(get_elapsed_ms(start));
+        }
+
+        auto first = times.front();
+        std::sort(times.begin(), times.end());
+        w.write_printf(
+            "%-28s %10.3f %10.3f %10.3f\n",
+            name.c_str(),
+            first,
+            times.front(),
+            times[times.size() / 2]);
+        w.flush_to_console();
+    }
+
+    /**
+     * Returns the offsets of the '\n' chars in @p text, found with
+     * std::string_view::find the way indented_writer_base split lines before
+     * it used find_newline.
+     */
+    std::vector<size_t> split_lines_scalar(std::string_view const& text)
+    {
+        std::vector<size_t> result;
+
+        for (auto pos = text.find('\n'); pos != std::string_view::npos;
+             pos = text.find('\n', pos + 1))
+        {
+            result.push_back(pos);
+        }
+
+        return result;
+    }
+
+    /**
+     * Returns the offsets of the '\n' chars in @p text, found with
+     * find_newline.
+     */
+    std::vector<size_t> split_lines(std::string_view const& text)
+    {
+        std::vector<size_t> result;
+        auto first = text.data();
+        auto const last = first + text.size();
+
+        for (auto newline = find_newline(first, last); newline != last;
+             newline = find_newline(newline + 1, last))
+        {
+            result.push_back(static_cast<size_t>(newline - first));
+        }
+
+        return result;
+    }
+
+    /**
+     * Indents @p text the way indented_writer_base::write_impl did before it
+     * used find_newline, as a reference for the writer output.
+     */
+    std::string indent_scalar(std::string_view const& text, int32_t indent)
+    {
+        std::string result;
+        std::string_view::size_type current_pos{0};
+        auto on_new_line = false;
+
+        while (current_pos < text.size())
+        {
+            auto pos = text.find('\n', current_pos);
+            auto line = text.substr(
+                current_pos,
+                pos == std::string_view::npos ? pos : pos - current_pos + 1);
+
+            if (on_new_line && line[0] != '\n')
+            {
+                result.append(indent * size_t{4}, ' ');
+            }
+
+            result.append(line);
+            on_new_line = pos != std::string_view::npos;
+            current_pos += line.size();
+        }
+
+        return result;
+    }
+
+    /**
+     * Returns lines of 0 to 79 chars, which is about what the code writers
+     * write per line.
+     */
+    std::string make_lines(size_t size)
+    {
+        std::string result;
+        result.reserve(size + 80);
+
+        for (uint32_t i{}; result.size() < size; i++)
+        {
+            for (uint32_t j{}, length{i * 37 % 80}; j < length; j++)
+            {
+                result.push_back(static_cast<char>('a' + (i + j) % 26));
+            }
+
+            result.push_back('\n');
+        }
+
+        return result;
+    }
+
+    /**
+     * Checks find_newline against the scalar line split. Every start
+     * alignment and every newline offset up to 96 is tried, which covers text
+     * shorter than the 16 char SSE2 block, text without a newline and a '\n'
+     * on either side of the 16 and 32 char block boundaries (offsets 15, 16,
+     * 31 and 32). The indented writer is then compared with the scalar
+     * indentation for lines that end on and next to a writer chunk boundary.
+     */
+    void check_line_split()
+    {
+        std::string buffer(128, 'x');
+
+        auto check = [](std::string_view const& text)
+        {
+            if (split_lines(text) != split_lines_scalar(text))
+            {
+                throw_invalid(
+                    "find_newline disagrees with the scalar split for ",
+                    std::to_string(text.size()),
+                    " chars at ",
+                    std::to_string(
+                        reinterpret_cast<uintptr_t>(text.data()) % 32),
+                    " bytes past a 32 byte boundary");
+            }
+        };
+
+        for (size_t offset{}; offset < 32; offset++)
+        {
+            for (size_t size{}; size <= 96; size++)
+            {
+                std::string_view text{buffer.data() + offset, size};
+                check(text);
+
+                for (size_t pos{}; pos < size; pos++)
+                {
+                    buffer[offset + pos] = '\n';
+                    check(text);
+                    buffer[offset + size - 1] = '\n';
+                    check(text);
+                    buffer[offset + pos] = 'x';
+                    buffer[offset + size - 1] = 'x';
+                }
+            }
+        }
+
+        constexpr auto chunk_size = chunked_buffer::chunk_size;
+
+        for (size_t size{chunk_size - 2}; size <= chunk_size + 2; size++)
+        {
+            // the first line isn't indented, so its '\n' is written at
+            // size - 1, around the end of the first chunk
+            auto text = std::string(size - 1, 'x') + '\n' + make_lines(2 * chunk_size);
+
+            writer out;
+            {
+                writer::indent_guard g{out};
+                out.write("%", text);
+            }
+
+            if (out.flush_to_string() != indent_scalar(text, 1))
+            {
+                throw_invalid(
+                    "the indented writer output differs from the scalar indentation");
+            }
+        }
+    }
+
+    struct projected_namespace
+    {
+        std::string_view ns;
+        cache::namespace_members members;
+        namespace_dependencies dependencies;
+    };
+
+    void run_writer_benchmarks(writer& w, benchmark_options const& options)
+    {
+        run_benchmark(
+            w,
+            options,
+            "writer_base format",
+            [](uint32_t)
+            {
+                writer out;
+
+                for (int32_t i{}; i < 100'000; i++)
+                {
+                    out.write(
+                        "static PyObject* _%_%(%, PyObject* %) noexcept\n",
+                        "Synthetic_N0_C0",
+                        i,
+                        "py::wrapper::Synthetic::N0::C0* self"sv,
+                        std::string{"args"});
+                }
+            });
+
+        run_benchmark(
+            w,
+            options,
+            "writer_base indented",
+            [](uint32_t)
+            {
+                writer out;
+
+                for (int32_t i{}; i < 20'000; i++)
+                {
+                    out.write("namespace n%\n{\n", i);
+                    {
+                        writer::indent_guard g{out};
+                        out.write("struct @\n{\n", "Synthetic.N0.C0");
+                        {
+                            writer::indent_guard g2{out};
+                            out.write("int32_t value{%};\n", i);
+                            out.write("int32_t flags{%};\n", i % 7);
+                        }
+                        out.write("};\n");
+                    }
+                    out.write("}\n");
+                }
+            });
+
+        // The line split that indented_writer_base used before find_newline
+        // against find_newline, over about the line lengths the code writers
+        // write.
+        auto lines = make_lines(8 * 1024 * 1024);
+        auto newlines = split_lines_scalar(lines).size();
+
+        auto check_newlines = [&](size_t count)
+        {
+            if (count != newlines)
+            {
+                throw_invalid(
+                    "found ",
+                    std::to_string(count),
+                    " newlines instead of ",
+                    std::to_string(newlines));
+            }
+
+            sink = count;
+        };
+
+        run_benchmark(
+            w,
+            options,
+            "line split find",
+            [&](uint32_t)
+            {
+                check_newlines(split_lines_scalar(lines).size());
+            });
+
+        run_benchmark(
+            w,
+            options,
+            "line split find_newline",
+            [&](uint32_t)
+            {
+                check_newlines(split_lines(lines).size());
+            });
+
+        // The same numbers through std::to_chars, which writer::write_value
+        // uses, and through printf, which it used before.
+        auto write_numbers = [](auto&& write_number)
+        {
+            writer out;
+
+            for (uint32_t i{}; i < 200'000; i++)
+            {
+                write_number(
+                    out,
+                    static_cast<int32_t>(i * 7919) - 1'000'000,
+                    i * 2654435761u,
+                    i * 0.37);
+            }
+        };
+
+        run_benchmark(
+            w,
+            options,
+            "numbers to_chars",
+            [&](uint32_t)
+            {
+                write_numbers(
+                    [](writer& out, int32_t value, uint32_t hex, double fixed)
+                    {
+                        out.write(value);
+                        out.write(' ');
+                        out.write_hex(hex);
+                        out.write(' ');
+                        out.write_fixed(fixed);
+                        out.write('\n');
+                    });
+            });
+
+        run_benchmark(
+            w,
+            options,
+            "numbers printf",
+            [&](uint32_t)
+            {
+                write_numbers(
+                    [](writer& out, int32_t value, uint32_t hex, double fixed)
+                    {
+                        out.write_printf("%d %#x %f\n", value, hex, fixed);
+                    });
+            });
+    }
+
+    void run_task_group_benchmarks(writer& w, benchmark_options const& options)
+    {
+        // Many short tasks that add more tasks from the workers while other
+        // workers are stealing, which is where a queued task could be missed.
+        // The count catches any task that was lost or run twice.
+        run_benchmark(
+            w,
+            options,
+            "task_group nested add",
+            [](uint32_t)
+            {
+                constexpr uint32_t top_level = 2'000;
+                constexpr uint32_t depth = 3;
+                constexpr uint32_t fan_out = 4;
+
+                std::atomic<uint32_t> count{};
+                task_group group;
+
+                auto add_tasks = [&](uint32_t level, auto const& self) -> void
+                {
+                    count++;
+
+                    if (level < depth)
+                    {
+                        for (uint32_t i{}; i < fan_out; i++)
+                        {
+                            group.add(
+                                [&, level]
+                                {
+                                    self(level + 1, self);
+                                });
+                        }
+                    }
+                };
+
+                for (uint32_t i{}; i < top_level; i++)
+                {
+                    group.add(
+                        [&]
+                        {
+                            add_tasks(0, add_tasks);
+                        });
+                }
+
+                group.get();
+
+                uint32_t expected{};
+
+                for (uint32_t level{}, tasks{top_level}; level <= depth; level++)
+                {
+                    expected += tasks;
+                    tasks *= fan_out;
+                }
+
+                if (count != expected)
+                {
+                    throw_invalid(
+                        "task_group ran ",
+                        std::to_string(count.load()),
+                        " tasks instead of ",
+                        std::to_string(expected));
+                }
+            });
+    }
+
+    void run_namespace_benchmarks(
+        writer& w,
+        benchmark_options const& options,
+        std::vector<projected_namespace> const& namespaces)
+    {
+        auto for_each_type = [&](auto&& func)
+        {
+            for (auto&& projected : namespaces)
+            {
+                for (auto&& type : projected.members.classes)
+                {
+                    func(projected, type);
+                }
+
+                for (auto&& type : projected.members.interfaces)
+                {
+                    func(projected, type);
+                }
+            }
+        };
+
+        run_benchmark(
+            w,
+            options,
+            "enumerate_methods",
+            [&](uint32_t)
+            {
+                size_t count{};
+
+                for_each_type(
+                    [&](projected_namespace const& projected, TypeDef const& type)
+                    {
+                        writer out;
+                        out.current_namespace = projected.ns;
+                        enumerate_methods(
+                            out,
+                            type,
+                            [&](MethodDef const&)
+                            {
+                                count++;
+                            });
+                    });
+
+                sink = count;
+            });
+
+        run_benchmark(
+            w,
+            options,
+            "write_inspectable_type",
+            [&](uint32_t)
+            {
+                for_each_type(
+                    [&](projected_namespace const& projected, TypeDef const& type)
+                    {
+                        writer out;
+                        out.current_namespace = projected.ns;
+                        out.needed_namespaces = projected.dependencies.namespaces;
+                        write_inspectable_type(out, type);
+                    });
+            });
+
+        run_benchmark(
+            w,
+            options,
+            "get_needed_namespaces",
+            [&](uint32_t)
+            {
+                size_t count{};
+
+                for (auto&& projected : namespaces)
+                {
+                    auto needed
+                        = get_needed_namespaces(projected.ns, projected.members);
+                    count += needed.namespaces.size();
+                }
+
+                sink = count;
+            });
+
+        // each run writes to a new folder so that every file is written rather
+        // than compared with the output of the previous run
+        auto generate = [&](uint32_t iteration, auto&& write_files)
+        {
+            auto run_folder
+                = options.output_folder / ("run" + std::to_string(iteration));
+
+            for (auto&& projected : namespaces)
+            {
+                auto ns_folder = run_folder / std::string{projected.ns};
+                std::filesystem::create_directories(ns_folder);
+                write_files(ns_folder, projected);
+            }
+        };
+
+        auto clean = [&]
+        {
+            for (uint32_t i{}; i < options.iterations; i++)
+            {
+                std::filesystem::remove_all(
+                    options.output_folder / ("run" + std::to_string(i)));
+            }
+        };
+
+        auto add_file_benchmark = [&](std::string const& name, auto&& write_files)
+        {
+            run_benchmark(
+                w,
+                options,
+                name,
+                [&](uint32_t iteration)
+                {
+                    generate(iteration, write_files);
+                });
+
+            clean();
+        };
+
+        add_file_benchmark(
+            "write_namespace_cpp",
+            [](auto const& folder, projected_namespace const& projected)
+            {
+                write_namespace_cpp(folder, projected.ns, projected.members);
+            });
+
+        add_file_benchmark(
+            "write_namespace_h",
+            [](auto const& folder, projected_namespace const& projected)
+            {
+                write_namespace_fwd_h(folder, projected.ns, projected.members);
+                write_namespace_h(
+                    folder, projected.ns, projected.dependencies, projected.members);
+            });
+
+        add_file_benchmark(
+            "write_namespace_dunder_init",
+            [](auto const& folder, projected_namespace const& projected)
+            {
+                write_namespace_dunder_init_py(
+                    folder,
+                    settings.module,
+                    projected.dependencies.namespaces,
+                    projected.ns,
+                    projected.members);
+                write_namespace_dunder_init_pyi(
+                    folder,
+                    projected.dependencies.namespaces,
+                    projected.ns,
+                    projected.members);
+            });
+
+        add_file_benchmark(
+            "namespace generation",
+            [](auto const& folder, projected_namespace const& projected)
+            {
+                auto needed = get_needed_namespaces(projected.ns, projected.members);
+                write_namespace_cpp(folder, projected.ns, projected.members);
+                write_namespace_fwd_h(folder, projected.ns, projected.members);
+                write_namespace_h(folder, projected.ns, needed, projected.members);
+                write_namespace_dunder_init_py(
+                    folder,
+                    settings.module,
+                    needed.namespaces,
+                    projected.ns,
+                    projected.members);
+                write_namespace_dunder_init_pyi(
+                    folder, needed.namespaces, projected.ns, projected.members);
+            });
+    }
+
+    int run(int const argc, char** argv)
+    {
+        writer w;
+        int result{};
+
+        try
+        {
+            auto options = parse_args(argc, argv);
+            settings.module = "winrt";
+            settings.filter = {settings.include, settings.exclude};
+            std::filesystem::create_directories(options.output_folder);
+
+            auto files = options.input;
+
+            if (files.empty())
+            {
+                auto path = options.output_folder / "Synthetic.winmd";
+                auto start = clock::now();
+                write_synthetic_winmd(path, options.metadata);
+                w.write_printf("synthetic metadata: %.3fms\n", get_elapsed_ms(start));
+                files.push_back(path.string());
+            }
+
+            auto load_start = clock::now();
+            cache c{files};
+            namespace_ids::assign(c);
+            w.write_printf("load: %.3fms\n", get_elapsed_ms(load_start));
+
+            std::vector<projected_namespace> namespaces;
+
+            for (auto&& [ns, members] : c.namespaces())
+            {
+                auto has_projected_types = !members.interfaces.empty()
+                                           || !members.classes.empty()
+                                           || !members.enums.empty()
+                                           || !members.structs.empty()
+                                           || !members.delegates.empty();
+
+                if (!has_projected_types || !settings.filter.includes(members))
+                {
+                    continue;
+                }
+
+                auto& projected = namespaces.emplace_back();
+                projected.ns = ns;
+                projected.members = filter_namespace_members(members, settings.filter);
+                projected.dependencies
+                    = get_needed_namespaces(projected.ns, projected.members);
+            }
+
+            w.write("namespaces: %\n\n", static_cast<uint32_t>(namespaces.size()));
+            w.write_printf(
+                "%-28s %10s %10s %10s\n", "benchmark (ms)", "first", "min", "median");
+            w.flush_to_console();
+
+            check_line_split();
+            run_writer_benchmarks(w, options);
+            run_task_group_benchmarks(w, options);
+            run_namespace_benchmarks(w, options, namespaces);
+        }
+        catch (usage_exception const&)
+        {
+            print_usage(w);
+        }
+        catch (std::exception const& e)
+        {
+            w.write(" error: %\n", e.what());
+            result = 1;
+        }
+
+        w.flush_to_console();
+        return result;
+    }
+} // namespace pywinrt::benchmark
+
+int main(int const argc, char** argv)
+{
+    return pywinrt::benchmark::run(argc, argv);
+}
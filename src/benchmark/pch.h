@@ -0,0 +1,10 @@
+#pragma once
+
+// The generator's pch.h without cmd_reader.h, which needs the Windows SDK.
+
+#include <winmd_reader.h>
+
+#include "hash.h"
+#include "task_group.h"
+#include "trace.h"
+#include "text_writer.h"
@@ -0,0 +1,1224 @@
+#pragma once
+
+#include "impl/pywinrt_base.h"
+
+namespace pywinrt::benchmark
+{
+    /**
+     * Writes a minimal ECMA-335 metadata file: a PE32 image with a single
+     * section that holds the CLI header and the metadata. Only the tables that
+     * the generator reads are supported.
+     *
+     * Rows are numbered from 1 in the order they are added. The caller adds the
+     * rows of the tables that the reader searches with a binary search
+     * (InterfaceImpl, Constant, GenericParam, PropertyMap and EventMap) in
+     * sorted order, except for MethodSemantics, which is sorted when saving.
+     */
+    struct metadata_builder
+    {
+        enum class table : uint8_t
+        {
+            module = 0x00,
+            type_ref = 0x01,
+            type_def = 0x02,
+            field = 0x04,
+            method_def = 0x06,
+            param = 0x08,
+            interface_impl = 0x09,
+            constant = 0x0b,
+            event_map = 0x12,
+            event = 0x14,
+            property_map = 0x15,
+            property = 0x17,
+            method_semantics = 0x18,
+            module_ref = 0x1a,
+            type_spec = 0x1b,
+            assembly = 0x20,
+            assembly_ref = 0x23,
+            generic_param = 0x2a,
+        };
+
+        enum class coded_index : uint8_t
+        {
+            type_def_or_ref,
+            has_constant,
+            resolution_scope,
+            has_semantics,
+            type_or_method_def,
+        };
+
+        metadata_builder()
+        {
+            m_strings.push_back('\0');
+            m_blobs.push_back('\0');
+        }
+
+        /**
+         * Adds a row and returns its index. The values are in column order;
+         * heap offsets, row indices and coded indices are passed as returned
+         * by string(), blob(), guid(), add_row() and encode().
+         */
+        uint32_t add_row(table t, std::initializer_list<uint32_t> values)
+        {
+            auto& rows = m_rows[static_cast<size_t>(t)];
+            assert(values.size() == get_schema(t).size());
+            rows.insert(rows.end(), values);
+            return row_count(t);
+        }
+
+        uint32_t row_count(table t) const noexcept
+        {
+            auto columns = get_schema(t).size();
+            auto values = m_rows[static_cast<size_t>(t)].size();
+            return static_cast<uint32_t>(columns == 0 ? 0 : values / columns);
+        }
+
+        uint32_t string(std::string_view const& value)
+        {
+            if (value.empty())
+            {
+                return 0;
+            }
+
+            auto [it, inserted] = m_string_offsets.try_emplace(
+                std::string{value}, static_cast<uint32_t>(m_strings.size()));
+
+            if (inserted)
+            {
+                m_strings.append(value);
+                m_strings.push_back('\0');
+            }
+
+            return it->second;
+        }
+
+        uint32_t blob(std::string_view const& value)
+        {
+            if (value.empty())
+            {
+                return 0;
+            }
+
+            auto [it, inserted] = m_blob_offsets.try_emplace(
+                std::string{value}, static_cast<uint32_t>(m_blobs.size()));
+
+            if (inserted)
+            {
+                write_compressed(m_blobs, static_cast<uint32_t>(value.size()));
+                m_blobs.append(value);
+            }
+
+            return it->second;
+        }
+
+        uint32_t guid(std::array<uint8_t, 16> const& value)
+        {
+            m_guids.append(reinterpret_cast<char const*>(value.data()), value.size());
+            return static_cast<uint32_t>(m_guids.size() / value.size());
+        }
+
+        static uint32_t encode(coded_index index, table t, uint32_t row)
+        {
+            auto [tables, bits] = get_coded_tables(index);
+            auto tag = std::find(tables.begin(), tables.end(), t);
+            assert(tag != tables.end());
+            return (row << bits) | static_cast<uint32_t>(tag - tables.begin());
+        }
+
+        /**
+         * Appends an unsigned integer in the compressed form used by blobs
+         * and signatures.
+         */
+        static void write_compressed(std::string& out, uint32_t value)
+        {
+            if (value < 0x80)
+            {
+                out.push_back(static_cast<char>(value));
+            }
+            else if (value < 0x4000)
+            {
+                out.push_back(static_cast<char>(0x80 | (value >> 8)));
+                out.push_back(static_cast<char>(value & 0xff));
+            }
+            else
+            {
+                assert(value < 0x20000000);
+                out.push_back(static_cast<char>(0xc0 | (value >> 24)));
+                out.push_back(static_cast<char>((value >> 16) & 0xff));
+                out.push_back(static_cast<char>((value >> 8) & 0xff));
+                out.push_back(static_cast<char>(value & 0xff));
+            }
+        }
+
+        void save(std::filesystem::path const& path)
+        {
+            sort_method_semantics();
+
+            auto metadata = write_metadata();
+            std::string cli_header(cli_header_size, '\0');
+            put<uint32_t>(cli_header, 0, cli_header_size);
+            put<uint16_t>(cli_header, 4, 2);
+            put<uint16_t>(cli_header, 6, 5);
+            put<uint32_t>(cli_header, 8, section_rva + cli_header_size);
+            put<uint32_t>(cli_header, 12, static_cast<uint32_t>(metadata.size()));
+            put<uint32_t>(cli_header, 16, 1); // COMIMAGE_FLAGS_ILONLY
+
+            auto section = cli_header + metadata;
+            auto section_size = static_cast<uint32_t>(section.size());
+            auto raw_size = align(section_size, file_alignment);
+
+            // DOS header, PE signature, file header, PE32 optional header and
+            // one section header
+            std::string image(file_alignment, '\0');
+            put<uint16_t>(image, 0, 0x5a4d);
+            put<uint32_t>(image, 0x3c, pe_offset);
+            put<uint32_t>(image, pe_offset, 0x4550);
+
+            auto file_header = pe_offset + 4;
+            put<uint16_t>(image, file_header, 0x14c);
+            put<uint16_t>(image, file_header + 2, 1);
+            put<uint16_t>(image, file_header + 16, optional_header_size);
+            put<uint16_t>(image, file_header + 18, 0x2102);
+
+            auto optional_header = file_header + 20;
+            put<uint16_t>(image, optional_header, 0x10b);
+            put<uint32_t>(image, optional_header + 4, raw_size);
+            put<uint32_t>(image, optional_header + 20, section_rva);
+            put<uint32_t>(image, optional_header + 28, 0x400000);
+            put<uint32_t>(image, optional_header + 32, section_alignment);
+            put<uint32_t>(image, optional_header + 36, file_alignment);
+            put<uint16_t>(image, optional_header + 40, 4);
+            put<uint16_t>(image, optional_header + 48, 4);
+            put<uint32_t>(
+                image,
+                optional_header + 56,
+                section_rva + align(section_size, section_alignment));
+            put<uint32_t>(image, optional_header + 60, file_alignment);
+            put<uint16_t>(image, optional_header + 68, 3);
+            put<uint32_t>(image, optional_header + 92, 16);
+
+            // the CLI header data directory
+            put<uint32_t>(image, optional_header + 96 + 14 * 8, section_rva);
+            put<uint32_t>(image, optional_header + 100 + 14 * 8, cli_header_size);
+
+            auto section_header = optional_header + optional_header_size;
+            image.replace(section_header, 5, ".text");
+            put<uint32_t>(image, section_header + 8, section_size);
+            put<uint32_t>(image, section_header + 12, section_rva);
+            put<uint32_t>(image, section_header + 16, raw_size);
+            put<uint32_t>(image, section_header + 20, file_alignment);
+            put<uint32_t>(image, section_header + 36, 0x60000020);
+
+            image += section;
+            image.resize(file_alignment + raw_size, '\0');
+
+            std::ofstream file{path, std::ios::out | std::ios::binary};
+            file.write(image.data(), image.size());
+
+            if (!file)
+            {
+                throw_invalid("Could not write '", path.string(), "'");
+            }
+        }
+
+      private:
+        enum class column : uint8_t
+        {
+            u16,
+            u32,
+            string,
+            blob,
+            guid,
+            type_def,
+            field,
+            method_def,
+            param,
+            event,
+            property,
+            type_def_or_ref,
+            has_constant,
+            resolution_scope,
+            has_semantics,
+            type_or_method_def,
+        };
+
+        static constexpr uint32_t cli_header_size{72};
+        static constexpr uint32_t pe_offset{0x80};
+        static constexpr uint16_t optional_header_size{224};
+        static constexpr uint32_t file_alignment{0x200};
+        static constexpr uint32_t section_alignment{0x2000};
+        static constexpr uint32_t section_rva{0x2000};
+
+        static std::vector<column> const& get_schema(table t)
+        {
+            using c = column;
+
+            static auto const schemas = []
+            {
+                std::array<std::vector<column>, 64> result;
+                auto set = [&](table t, std::vector<column> columns)
+                {
+                    result[static_cast<size_t>(t)] = std::move(columns);
+                };
+
+                set(table::module, {c::u16, c::string, c::guid, c::guid, c::guid});
+                set(table::type_ref, {c::resolution_scope, c::string, c::string});
+                set(table::type_def,
+                    {c::u32,
+                     c::string,
+                     c::string,
+                     c::type_def_or_ref,
+                     c::field,
+                     c::method_def});
+                set(table::field, {c::u16, c::string, c::blob});
+                set(table::method_def,
+                    {c::u32, c::u16, c::u16, c::string, c::blob, c::param});
+                set(table::param, {c::u16, c::u16, c::string});
+                set(table::interface_impl, {c::type_def, c::type_def_or_ref});
+                set(table::constant, {c::u16, c::has_constant, c::blob});
+                set(table::event_map, {c::type_def, c::event});
+                set(table::event, {c::u16, c::string, c::type_def_or_ref});
+                set(table::property_map, {c::type_def, c::property});
+                set(table::property, {c::u16, c::string, c::blob});
+                set(table::method_semantics, {c::u16, c::method_def, c::has_semantics});
+                set(table::module_ref, {c::string});
+                set(table::type_spec, {c::blob});
+                set(table::assembly,
+                    {c::u32,
+                     c::u16,
+                     c::u16,
+                     c::u16,
+                     c::u16,
+                     c::u32,
+                     c::blob,
+                     c::string,
+                     c::string});
+                set(table::assembly_ref,
+                    {c::u16,
+                     c::u16,
+                     c::u16,
+                     c::u16,
+                     c::u32,
+                     c::blob,
+                     c::string,
+                     c::string,
+                     c::blob});
+                set(table::generic_param,
+                    {c::u16, c::u16, c::type_or_method_def, c::string});
+                return result;
+            }();
+
+            return schemas[static_cast<size_t>(t)];
+        }
+
+        static std::pair<std::vector<table>, uint32_t> get_coded_tables(
+            coded_index index)
+        {
+            switch (index)
+            {
+            case coded_index::type_def_or_ref:
+                return {{table::type_def, table::type_ref, table::type_spec}, 2};
+            case coded_index::has_constant:
+                return {{table::field, table::param, table::property}, 2};
+            case coded_index::resolution_scope:
+                return {
+                    {table::module,
+                     table::module_ref,
+                     table::assembly_ref,
+                     table::type_ref},
+                    2};
+            case coded_index::has_semantics:
+                return {{table::event, table::property}, 1};
+            case coded_index::type_or_method_def:
+                return {{table::type_def, table::method_def}, 1};
+            }
+
+            throw_invalid("Unknown coded index");
+        }
+
+        template<typename T>
+        static void put(std::string& out, size_t offset, T value)
+        {
+            for (size_t i{}; i < sizeof(T); i++)
+            {
+                out[offset + i] = static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        template<typename T>
+        static void append(std::string& out, T value)
+        {
+            out.resize(out.size() + sizeof(T));
+            put(out, out.size() - sizeof(T), value);
+        }
+
+        static uint32_t align(uint32_t value, uint32_t alignment) noexcept
+        {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        static void pad(std::string& out)
+        {
+            out.resize(align(static_cast<uint32_t>(out.size()), 4), '\0');
+        }
+
+        void sort_method_semantics()
+        {
+            auto& values = m_rows[static_cast<size_t>(table::method_semantics)];
+            std::vector<std::array<uint32_t, 3>> rows(values.size() / 3);
+            std::memcpy(rows.data(), values.data(), values.size() * sizeof(uint32_t));
+            std::stable_sort(
+                rows.begin(),
+                rows.end(),
+                [](auto const& lhs, auto const& rhs)
+                {
+                    return lhs[2] < rhs[2];
+                });
+            std::memcpy(values.data(), rows.data(), values.size() * sizeof(uint32_t));
+        }
+
+        uint32_t get_column_size(column c) const
+        {
+            auto index_size = [this](table t)
+            {
+                return row_count(t) < (1u << 16) ? 2u : 4u;
+            };
+
+            auto coded_size = [this](coded_index index)
+            {
+                auto [tables, bits] = get_coded_tables(index);
+
+                for (auto t : tables)
+                {
+                    if (row_count(t) >= (1u << (16 - bits)))
+                    {
+                        return 4u;
+                    }
+                }
+
+                return 2u;
+            };
+
+            switch (c)
+            {
+            case column::u16:
+                return 2;
+            case column::u32:
+                return 4;
+            case column::string:
+                return m_strings.size() < (1u << 16) ? 2 : 4;
+            case column::blob:
+                return m_blobs.size() < (1u << 16) ? 2 : 4;
+            case column::guid:
+                return m_guids.size() / 16 < (1u << 16) ? 2 : 4;
+            case column::type_def:
+                return index_size(table::type_def);
+            case column::field:
+                return index_size(table::field);
+            case column::method_def:
+                return index_size(table::method_def);
+            case column::param:
+                return index_size(table::param);
+            case column::event:
+                return index_size(table::event);
+            case column::property:
+                return index_size(table::property);
+            case column::type_def_or_ref:
+                return coded_size(coded_index::type_def_or_ref);
+            case column::has_constant:
+                return coded_size(coded_index::has_constant);
+            case column::resolution_scope:
+                return coded_size(coded_index::resolution_scope);
+            case column::has_semantics:
+                return coded_size(coded_index::has_semantics);
+            case column::type_or_method_def:
+                return coded_size(coded_index::type_or_method_def);
+            }
+
+            throw_invalid("Unknown column");
+        }
+
+        std::string write_tables() const
+        {
+            std::string out;
+            uint64_t valid{};
+
+            for (size_t t{}; t < m_rows.size(); t++)
+            {
+                if (!m_rows[t].empty())
+                {
+                    valid |= uint64_t{1} << t;
+                }
+            }
+
+            uint8_t heap_sizes{};
+            heap_sizes |= m_strings.size() < (1u << 16) ? 0 : 1;
+            heap_sizes |= m_guids.size() / 16 < (1u << 16) ? 0 : 2;
+            heap_sizes |= m_blobs.size() < (1u << 16) ? 0 : 4;
+
+            append<uint32_t>(out, 0);
+            append<uint8_t>(out, 2);
+            append<uint8_t>(out, 0);
+            append<uint8_t>(out, heap_sizes);
+            append<uint8_t>(out, 1);
+            append<uint64_t>(out, valid);
+            append<uint64_t>(out, 0x000016003301fa00);
+
+            for (size_t t{}; t < m_rows.size(); t++)
+            {
+                if (!m_rows[t].empty())
+                {
+                    append<uint32_t>(out, row_count(static_cast<table>(t)));
+                }
+            }
+
+            for (size_t t{}; t < m_rows.size(); t++)
+            {
+                auto const& schema = get_schema(static_cast<table>(t));
+                auto const& values = m_rows[t];
+
+                for (size_t i{}; i < values.size(); i++)
+                {
+                    if (get_column_size(schema[i % schema.size()]) == 2)
+                    {
+                        assert(values[i] < (1u << 16));
+                        append<uint16_t>(out, static_cast<uint16_t>(values[i]));
+                    }
+                    else
+                    {
+                        append<uint32_t>(out, values[i]);
+                    }
+                }
+            }
+
+            pad(out);
+            return out;
+        }
+
+        std::string write_metadata() const
+        {
+            static constexpr std::string_view version{"WindowsRuntime 1.4"};
+
+            std::string strings{m_strings};
+            std::string blobs{m_blobs};
+            std::string user_strings(1, '\0');
+            pad(strings);
+            pad(blobs);
+            pad(user_strings);
+
+            std::pair<std::string_view, std::string const*> const streams[]{
+                {"#~", nullptr},
+                {"#Strings", &strings},
+                {"#US", &user_strings},
+                {"#GUID", &m_guids},
+                {"#Blob", &blobs},
+            };
+
+            auto tables = write_tables();
+            auto version_size = align(static_cast<uint32_t>(version.size() + 1), 4);
+            auto offset = 20 + version_size;
+
+            for (auto&& [name, data] : streams)
+            {
+                offset += 8 + align(static_cast<uint32_t>(name.size() + 1), 4);
+            }
+
+            std::string out;
+            append<uint32_t>(out, 0x424a5342);
+            append<uint16_t>(out, 1);
+            append<uint16_t>(out, 1);
+            append<uint32_t>(out, 0);
+            append<uint32_t>(out, version_size);
+            out.append(version);
+            out.resize(16 + version_size, '\0');
+            append<uint16_t>(out, 0);
+            append<uint16_t>(out, static_cast<uint16_t>(std::size(streams)));
+
+            for (auto&& [name, data] : streams)
+            {
+                auto size = static_cast<uint32_t>(data ? data->size() : tables.size());
+                append<uint32_t>(out, offset);
+                append<uint32_t>(out, size);
+                out.append(name);
+                out.push_back('\0');
+                pad(out);
+                offset += size;
+            }
+
+            out += tables;
+
+            for (auto&& [name, data] : streams)
+            {
+                if (data)
+                {
+                    out += *data;
+                }
+            }
+
+            return out;
+        }
+
+        std::array<std::vector<uint32_t>, 64> m_rows;
+        std::string m_strings;
+        std::string m_blobs;
+        std::string m_guids;
+        std::unordered_map<std::string, uint32_t> m_string_offsets;
+        std::unordered_map<std::string, uint32_t> m_blob_offsets;
+    };
+
+    /**
+     * The shape of the metadata created by write_synthetic_winmd(). All of the
+     * counts except the number of namespaces are per namespace.
+     */
+    struct synthetic_options
+    {
+        uint32_t namespaces{4};
+        uint32_t classes{50};
+        uint32_t enums{8};
+        uint32_t structs{8};
+        uint32_t delegates{4};
+
+        // the number of methods, properties and events on each interface
+        uint32_t methods{10};
+        uint32_t properties{4};
+        uint32_t events{1};
+
+        // the number of interfaces in the chain of required interfaces of each
+        // class
+        uint32_t depth{4};
+    };
+
+    /**
+     * Writes a metadata file with the given number of namespaces named
+     * Synthetic.N0, Synthetic.N1 and so on.
+     *
+     * Each namespace has enums, structs, delegates, a generic IBox`1 interface
+     * and classes. Each class implements a chain of interfaces where every
+     * interface requires the next one and the last one requires an IBox`1
+     * instance, and has the methods, properties and events of all of them.
+     * Method signatures cycle through every kind of type and parameter the
+     * generator handles and instantiate IBox`1 with every type in the
+     * namespace. Windows.Foundation.EventRegistrationToken is also defined,
+     * since the generator needs it for events.
+     */
+    inline void write_synthetic_winmd(
+        std::filesystem::path const& path, synthetic_options options)
+    {
+        using table = metadata_builder::table;
+        using coded = metadata_builder::coded_index;
+
+        // every kind of type is needed for the method signatures
+        options.classes = std::max(options.classes, 1u);
+        options.enums = std::max(options.enums, 1u);
+        options.structs = std::max(options.structs, 1u);
+        options.delegates = std::max(options.delegates, 1u);
+        options.depth = std::max(options.depth, 1u);
+
+        enum element_type : uint8_t
+        {
+            void_type = 0x01,
+            boolean = 0x02,
+            i4 = 0x08,
+            i8 = 0x0a,
+            r8 = 0x0d,
+            string_type = 0x0e,
+            by_ref = 0x10,
+            value_type = 0x11,
+            class_type = 0x12,
+            var = 0x13,
+            generic_inst = 0x15,
+            native_int = 0x18,
+            object = 0x1c,
+            sz_array = 0x1d,
+        };
+
+        enum : uint16_t
+        {
+            param_in = 0x1,
+            param_out = 0x2,
+        };
+
+        struct param_spec
+        {
+            std::string name;
+            uint16_t flags;
+            std::string type;
+        };
+
+        struct method_spec
+        {
+            std::string name;
+            std::string return_type;
+            std::vector<param_spec> params;
+        };
+
+        struct property_spec
+        {
+            std::string name;
+            std::string type;
+            bool writable;
+        };
+
+        struct event_spec
+        {
+            std::string name;
+            uint32_t delegate;
+        };
+
+        struct member_specs
+        {
+            std::vector<method_spec> methods;
+            std::vector<property_spec> properties;
+            std::vector<event_spec> events;
+
+            void append(member_specs const& other)
+            {
+                methods.insert(
+                    methods.end(), other.methods.begin(), other.methods.end());
+                properties.insert(
+                    properties.end(), other.properties.begin(), other.properties.end());
+                events.insert(events.end(), other.events.begin(), other.events.end());
+            }
+        };
+
+        metadata_builder b;
+
+        auto element = [](element_type type)
+        {
+            return std::string(1, static_cast<char>(type));
+        };
+
+        auto type_def = [](element_type kind, uint32_t row)
+        {
+            std::string result(1, static_cast<char>(kind));
+            metadata_builder::write_compressed(
+                result,
+                metadata_builder::encode(coded::type_def_or_ref, table::type_def, row));
+            return result;
+        };
+
+        auto method_signature = [](std::string const& return_type,
+                                   std::vector<param_spec> const& params)
+        {
+            std::string result(1, '\x20'); // HASTHIS
+            metadata_builder::write_compressed(
+                result, static_cast<uint32_t>(params.size()));
+            result += return_type;
+
+            for (auto&& param : params)
+            {
+                result += param.type;
+            }
+
+            return result;
+        };
+
+        auto add_type = [&](uint32_t flags,
+                            std::string_view const& ns,
+                            std::string_view const& name,
+                            uint32_t extends)
+        {
+            return b.add_row(
+                table::type_def,
+                {flags,
+                 b.string(name),
+                 b.string(ns),
+                 extends,
+                 b.row_count(table::field) + 1,
+                 b.row_count(table::method_def) + 1});
+        };
+
+        auto add_field =
+            [&](uint16_t flags, std::string_view const& name, std::string const& type)
+        {
+            return b.add_row(
+                table::field, {flags, b.string(name), b.blob("\x06" + type)});
+        };
+
+        auto add_method = [&](uint16_t flags,
+                              uint16_t impl_flags,
+                              std::string_view const& name,
+                              std::string const& return_type,
+                              std::vector<param_spec> const& params)
+        {
+            auto row = b.add_row(
+                table::method_def,
+                {0,
+                 impl_flags,
+                 flags,
+                 b.string(name),
+                 b.blob(method_signature(return_type, params)),
+                 b.row_count(table::param) + 1});
+
+            for (uint16_t i{}; i < params.size(); i++)
+            {
+                b.add_row(
+                    table::param,
+                    {params[i].flags, uint16_t(i + 1), b.string(params[i].name)});
+            }
+
+            return row;
+        };
+
+        auto add_type_ref =
+            [&](std::string_view const& ns, std::string_view const& name)
+        {
+            return metadata_builder::encode(
+                coded::type_def_or_ref,
+                table::type_ref,
+                b.add_row(
+                    table::type_ref,
+                    {metadata_builder::encode(
+                         coded::resolution_scope, table::assembly_ref, 1),
+                     b.string(name),
+                     b.string(ns)}));
+        };
+
+        constexpr uint16_t method_public = 0x0006;
+        constexpr uint16_t method_hide_by_sig = 0x0080;
+        constexpr uint16_t method_special_name = 0x0800;
+        constexpr uint16_t method_rt_special_name = 0x1000;
+        constexpr uint16_t method_virtual = 0x0040 | 0x0100; // and NewSlot
+        constexpr uint16_t interface_method
+            = method_public | method_hide_by_sig | method_virtual | 0x0400; // Abstract
+        constexpr uint16_t class_method
+            = method_public | method_hide_by_sig | method_virtual | 0x0020; // Final
+        constexpr uint16_t constructor = method_public | method_hide_by_sig
+                                         | method_special_name | method_rt_special_name;
+        constexpr uint16_t runtime_impl = 0x0003;
+
+        constexpr uint32_t type_public = 0x0001;
+        constexpr uint32_t type_sealed = 0x0100;
+        constexpr uint32_t type_windows_runtime = 0x4000;
+        // Interface and Abstract
+        constexpr uint32_t interface_flags
+            = type_public | 0x0020 | 0x0080 | type_windows_runtime;
+        constexpr uint32_t sealed_flags
+            = type_public | type_sealed | type_windows_runtime;
+        constexpr uint32_t struct_flags = sealed_flags | 0x0008; // SequentialLayout
+
+        /**
+         * Adds the methods, properties and events of the type that was just
+         * added as @p owner.
+         */
+        auto add_members =
+            [&](uint32_t owner, member_specs const& members, uint16_t flags)
+        {
+            auto impl_flags = flags == interface_method ? uint16_t{} : runtime_impl;
+
+            for (auto&& method : members.methods)
+            {
+                add_method(
+                    flags, impl_flags, method.name, method.return_type, method.params);
+            }
+
+            std::vector<std::pair<uint16_t, uint32_t>> semantics;
+            auto accessor = flags | method_special_name;
+
+            for (auto&& prop : members.properties)
+            {
+                auto get = add_method(
+                    accessor, impl_flags, "get_" + prop.name, prop.type, {});
+                semantics.emplace_back(0x2, get);
+
+                if (prop.writable)
+                {
+                    auto put = add_method(
+                        accessor,
+                        impl_flags,
+                        "put_" + prop.name,
+                        element(void_type),
+                        {{"value", param_in, prop.type}});
+                    semantics.emplace_back(0x1, put);
+                }
+            }
+
+            if (!members.properties.empty())
+            {
+                b.add_row(
+                    table::property_map,
+                    {owner, b.row_count(table::property) + 1});
+                size_t next_semantic{};
+
+                for (auto&& prop : members.properties)
+                {
+                    auto row = b.add_row(
+                        table::property,
+                        {0, b.string(prop.name), b.blob("\x28\x00"s + prop.type)});
+                    auto association = metadata_builder::encode(
+                        coded::has_semantics, table::property, row);
+
+                    for (auto count = prop.writable ? 2 : 1; count > 0; count--)
+                    {
+                        auto [semantic, method] = semantics[next_semantic++];
+                        b.add_row(
+                            table::method_semantics, {semantic, method, association});
+                    }
+                }
+            }
+
+            if (!members.events.empty())
+            {
+                auto token = type_def(value_type, 2);
+                b.add_row(table::event_map, {owner, b.row_count(table::event) + 1});
+
+                for (auto&& evt : members.events)
+                {
+                    auto add = add_method(
+                        accessor,
+                        impl_flags,
+                        "add_" + evt.name,
+                        token,
+                        {{"handler", param_in, type_def(class_type, evt.delegate)}});
+                    auto remove = add_method(
+                        accessor,
+                        impl_flags,
+                        "remove_" + evt.name,
+                        element(void_type),
+                        {{"token", param_in, token}});
+
+                    auto row = b.add_row(
+                        table::event,
+                        {0,
+                         b.string(evt.name),
+                         metadata_builder::encode(
+                             coded::type_def_or_ref, table::type_def, evt.delegate)});
+                    auto association = metadata_builder::encode(
+                        coded::has_semantics, table::event, row);
+                    b.add_row(table::method_semantics, {0x8, add, association});
+                    b.add_row(table::method_semantics, {0x10, remove, association});
+                }
+            }
+        };
+
+        b.add_row(
+            table::module,
+            {0,
+             b.string("Synthetic.winmd"),
+             b.guid({0x5f, 0x1a, 0x2b, 0x3c, 0x4d, 0x5e, 0x6f, 0x70,
+                     0x81, 0x92, 0xa3, 0xb4, 0xc5, 0xd6, 0xe7, 0xf8}),
+             0,
+             0});
+        b.add_row(
+            table::assembly,
+            {0x8004, 255, 255, 255, 255, 0x200, 0, b.string("Synthetic"), 0});
+        b.add_row(
+            table::assembly_ref,
+            {4,
+             0,
+             0,
+             0,
+             0,
+             b.blob("\xb7\x7a\x5c\x56\x19\x34\xe0\x89"),
+             b.string("mscorlib"),
+             0,
+             0});
+
+        auto system_object = add_type_ref("System", "Object");
+        auto system_enum = add_type_ref("System", "Enum");
+        auto system_value_type = add_type_ref("System", "ValueType");
+        auto system_delegate = add_type_ref("System", "MulticastDelegate");
+
+        add_type(0, "", "<Module>", 0);
+        add_type(
+            struct_flags,
+            "Windows.Foundation",
+            "EventRegistrationToken",
+            system_value_type);
+        add_field(0x0006, "Value", element(i8));
+
+        auto const per_namespace = options.enums + options.structs + options.delegates
+                                   + 1 + options.classes * (options.depth + 1);
+
+        for (uint32_t n{}; n < options.namespaces; n++)
+        {
+            auto const ns = "Synthetic.N" + std::to_string(n);
+            auto const first_row = 3 + n * per_namespace;
+            auto const enum_row = first_row;
+            auto const struct_row = enum_row + options.enums;
+            auto const delegate_row = struct_row + options.structs;
+            auto const box_row = delegate_row + options.delegates;
+            auto const interface_row = box_row + 1;
+            auto const class_row = interface_row + options.classes * options.depth;
+
+            auto enum_type = [&](uint32_t i)
+            {
+                return type_def(value_type, enum_row + i % options.enums);
+            };
+
+            auto struct_type = [&](uint32_t i)
+            {
+                return type_def(value_type, struct_row + i % options.structs);
+            };
+
+            auto delegate_type = [&](uint32_t i)
+            {
+                return type_def(class_type, delegate_row + i % options.delegates);
+            };
+
+            auto runtime_class = [&](uint32_t i)
+            {
+                return type_def(class_type, class_row + i % options.classes);
+            };
+
+            std::vector<std::string> box_args{
+                element(i4), element(string_type), element(r8), element(boolean)};
+
+            for (uint32_t i{}; i < options.enums; i++)
+            {
+                box_args.push_back(enum_type(i));
+            }
+
+            for (uint32_t i{}; i < options.structs; i++)
+            {
+                box_args.push_back(struct_type(i));
+            }
+
+            for (uint32_t i{}; i < options.delegates; i++)
+            {
+                box_args.push_back(delegate_type(i));
+            }
+
+            for (uint32_t i{}; i < options.classes; i++)
+            {
+                box_args.push_back(runtime_class(i));
+            }
+
+            auto box = [&](uint32_t i)
+            {
+                std::string result{static_cast<char>(generic_inst)};
+                result += type_def(class_type, box_row);
+                result.push_back(1);
+                result += box_args[i % box_args.size()];
+                return result;
+            };
+
+            for (uint32_t i{}; i < options.enums; i++)
+            {
+                auto row =
+                    add_type(sealed_flags, ns, "E" + std::to_string(i), system_enum);
+                assert(row == enum_row + i);
+                add_field(0x0606, "value__", element(i4));
+
+                for (int32_t value{}; value < 8; value++)
+                {
+                    auto field = add_field(
+                        0x8056,
+                        "Value" + std::to_string(value),
+                        type_def(value_type, row));
+                    auto constant = static_cast<uint32_t>(value * (i + 1));
+                    std::string bytes;
+
+                    for (auto shift : {0, 8, 16, 24})
+                    {
+                        bytes.push_back(static_cast<char>((constant >> shift) & 0xff));
+                    }
+
+                    b.add_row(
+                        table::constant,
+                        {i4,
+                         metadata_builder::encode(
+                             coded::has_constant, table::field, field),
+                         b.blob(bytes)});
+                }
+            }
+
+            for (uint32_t i{}; i < options.structs; i++)
+            {
+                auto row = add_type(
+                    struct_flags, ns, "S" + std::to_string(i), system_value_type);
+                assert(row == struct_row + i);
+                add_field(0x0006, "Count", element(i4));
+                add_field(0x0006, "Ratio", element(r8));
+                add_field(0x0006, "Enabled", element(boolean));
+                add_field(0x0006, "Kind", enum_type(i));
+
+                if (i > 0)
+                {
+                    add_field(0x0006, "Inner", struct_type(i - 1));
+                }
+            }
+
+            for (uint32_t i{}; i < options.delegates; i++)
+            {
+                auto row = add_type(
+                    sealed_flags, ns, "D" + std::to_string(i), system_delegate);
+                assert(row == delegate_row + i);
+                add_method(
+                    constructor,
+                    runtime_impl,
+                    ".ctor",
+                    element(void_type),
+                    {{"object", 0, element(object)},
+                     {"method", 0, element(native_int)}});
+                add_method(
+                    method_public | method_hide_by_sig | method_virtual
+                        | method_special_name,
+                    runtime_impl,
+                    "Invoke",
+                    i % 2 ? element(i4) : element(void_type),
+                    {{"sender", param_in, runtime_class(i)},
+                     {"args", param_in, box(i)}});
+            }
+
+            auto box_members = [&](std::string const& type)
+            {
+                member_specs result;
+                result.methods.push_back(
+                    {"Replace", type, {{"value", param_in, type}}});
+                result.properties.push_back({"Value", type, true});
+                return result;
+            };
+
+            {
+                auto row = add_type(interface_flags, ns, "IBox`1", 0);
+                assert(row == box_row);
+                b.add_row(
+                    table::generic_param,
+                    {0,
+                     0,
+                     metadata_builder::encode(
+                         coded::type_or_method_def, table::type_def, row),
+                     b.string("T")});
+                add_members(row, box_members("\x13\x00"s), interface_method);
+            }
+
+            auto interface_members = [&](uint32_t c, uint32_t d)
+            {
+                member_specs result;
+                auto prefix = d == 0 ? "" : "Level" + std::to_string(d);
+
+                for (uint32_t m{}; m < options.methods; m++)
+                {
+                    auto name = prefix + "Method" + std::to_string(m);
+                    auto k = c + m;
+
+                    switch (m % 6)
+                    {
+                    case 0:
+                        result.methods.push_back(
+                            {name,
+                             element(i4),
+                             {{"count", param_in, element(i4)},
+                              {"name", param_in, element(string_type)}}});
+                        break;
+                    case 1:
+                        result.methods.push_back(
+                            {name,
+                             element(void_type),
+                             {{"value", param_in, struct_type(k)}}});
+                        break;
+                    case 2:
+                        result.methods.push_back(
+                            {name,
+                             enum_type(k),
+                             {{"value", param_in, enum_type(k + 1)}}});
+                        break;
+                    case 3:
+                        result.methods.push_back(
+                            {name, box(k * 7), {{"value", param_in, box(k * 3 + 1)}}});
+                        break;
+                    case 4:
+                        result.methods.push_back(
+                            {name,
+                             element(boolean),
+                             {{"items", param_in, element(sz_array) + element(i4)},
+                              {"count", param_out, element(by_ref) + element(i4)}}});
+                        break;
+                    default:
+                        result.methods.push_back(
+                            {name,
+                             runtime_class(k + 1),
+                             {{"handler", param_in, delegate_type(k)}}});
+                        break;
+                    }
+                }
+
+                for (uint32_t p{}; p < options.properties; p++)
+                {
+                    auto name = prefix + "Property" + std::to_string(p);
+                    auto k = c + p;
+                    std::string const types[]{
+                        element(i4), element(string_type), struct_type(k), box(k * 5)};
+                    result.properties.push_back(
+                        {name, types[p % std::size(types)], p % 2 == 0});
+                }
+
+                for (uint32_t e{}; e < options.events; e++)
+                {
+                    result.events.push_back(
+                        {prefix + "Changed" + std::to_string(e),
+                         delegate_row + (c + e) % options.delegates});
+                }
+
+                return result;
+            };
+
+            for (uint32_t c{}; c < options.classes; c++)
+            {
+                for (uint32_t d{}; d < options.depth; d++)
+                {
+                    auto name = "IC" + std::to_string(c);
+
+                    if (d > 0)
+                    {
+                        name += "Level" + std::to_string(d);
+                    }
+
+                    auto row = add_type(interface_flags, ns, name, 0);
+                    assert(row == interface_row + c * options.depth + d);
+                    uint32_t required{};
+
+                    if (d + 1 < options.depth)
+                    {
+                        required = metadata_builder::encode(
+                            coded::type_def_or_ref, table::type_def, row + 1);
+                    }
+                    else
+                    {
+                        auto spec = b.add_row(table::type_spec, {b.blob(box(c))});
+                        required = metadata_builder::encode(
+                            coded::type_def_or_ref, table::type_spec, spec);
+                    }
+
+                    b.add_row(table::interface_impl, {row, required});
+                    add_members(row, interface_members(c, d), interface_method);
+                }
+            }
+
+            for (uint32_t c{}; c < options.classes; c++)
+            {
+                auto row =
+                    add_type(sealed_flags, ns, "C" + std::to_string(c), system_object);
+                assert(row == class_row + c);
+                b.add_row(
+                    table::interface_impl,
+                    {row,
+                     metadata_builder::encode(
+                         coded::type_def_or_ref,
+                         table::type_def,
+                         interface_row + c * options.depth)});
+
+                add_method(constructor, runtime_impl, ".ctor", element(void_type), {});
+                add_method(
+                    constructor,
+                    runtime_impl,
+                    ".ctor",
+                    element(void_type),
+                    {{"count", param_in, element(i4)}});
+
+                member_specs members;
+
+                for (uint32_t d{}; d < options.depth; d++)
+                {
+                    members.append(interface_members(c, d));
+                }
+
+                members.append(box_members(box_args[c % box_args.size()]));
+                add_members(row, members, class_method);
+            }
+        }
+
+        b.save(path);
+    }
+} // namespace pywinrt::benchmark
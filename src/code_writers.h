@@ -3,83 +3,190 @@
 namespace pywinrt
 {
     template<typename F>
-    void write_snake_case(writer& w, std::string_view const& name, F case_func)
+    std::string to_snake_case(std::string_view const& name, F case_func)
     {
         assert(name.size() > 0);
 
+        std::string result;
+        result.reserve(name.size() + name.size() / 2);
+
         for (std::string_view::size_type i = 0; i < name.size(); i++)
         {
             if (isupper(name[i]) && i > 0)
             {
-                static const std::set<std::string_view> casing_exceptions
-                    = {"UInt", "IPAddress"};
+                static constexpr std::string_view casing_exceptions[]{
+                    "UInt", "IPAddress"};
 
                 auto sub = name.substr(i - 1);
                 if (sub[0] != '_'
                     && std::none_of(
-                        casing_exceptions.begin(),
-                        casing_exceptions.end(),
+                        std::begin(casing_exceptions),
+                        std::end(casing_exceptions),
                         [&sub](std::string_view v)
                         {
                             return sub.substr(0, v.length()) == v;
                         }))
                 {
-                    w.write('_');
+                    result += '_';
                 }
             }
 
-            w.write(case_func(name[i]));
+            result += case_func(name[i]);
         }
+
+        return result;
     }
 
-    void write_upper_snake_case(writer& w, std::string_view const& name)
+    /**
+     * The Python keywords.
+     *
+     * https://docs.python.org/3/reference/lexical_analysis.html#keywords
+     */
+    inline constexpr std::string_view python_keywords[]{
+        "and",      "as",       "assert", "async", "await",  "break",  "class",
+        "continue", "def",      "del",    "elif",  "else",   "except", "finally",
+        "for",      "from",     "global", "if",    "import", "in",     "is",
+        "lambda",   "nonlocal", "not",    "or",    "pass",   "raise",  "return",
+        "try",      "while",    "with",   "yield",
+    };
+
+    inline constexpr size_t python_keyword_table_size{64};
+
+    /**
+     * A perfect hash of python_keywords: each keyword gets its own slot in
+     * python_keyword_table, so a lookup is one string comparison.
+     */
+    constexpr size_t hash_python_keyword(std::string_view const& name) noexcept
     {
-        write_snake_case(
-            w,
-            name,
-            [](char c)
-            {
-                return static_cast<char>(::toupper(c));
-            });
+        return (name.size() * 29 + static_cast<unsigned char>(name.front())
+                + static_cast<unsigned char>(name.back()) * 15)
+               % python_keyword_table_size;
     }
 
-    void write_lower_snake_case(writer& w, std::string_view const& name)
+    constexpr auto make_python_keyword_table() noexcept
     {
-        write_snake_case(
-            w,
-            name,
-            [](char c)
+        std::array<std::string_view, python_keyword_table_size> table{};
+
+        for (auto&& keyword : python_keywords)
+        {
+            table[hash_python_keyword(keyword)] = keyword;
+        }
+
+        return table;
+    }
+
+    inline constexpr auto python_keyword_table = make_python_keyword_table();
+
+    constexpr bool is_python_keyword(std::string_view const& name) noexcept
+    {
+        return !name.empty() && python_keyword_table[hash_python_keyword(name)] == name;
+    }
+
+    constexpr bool is_python_keyword_table_perfect() noexcept
+    {
+        // a collision would overwrite a keyword, so it would not be found
+        for (auto&& keyword : python_keywords)
+        {
+            if (!is_python_keyword(keyword))
             {
-                return static_cast<char>(::tolower(c));
-            });
+                return false;
+            }
+        }
+
+        return true;
     }
 
+    static_assert(
+        is_python_keyword_table_perfect(),
+        "hash_python_keyword() needs new constants for the current keywords");
+
+    enum class identifier_casing
+    {
+        upper_snake_case,
+        lower_snake_case,
+        python_identifier,
+        count
+    };
+
     /**
-     * Converts @p name to lower_snake_case and adds a trailing underscore if
-     * @p name is a Python keyword.
-     *
-     * https://docs.python.org/3/reference/lexical_analysis.html#keywords
+     * Gets @p name converted to @p casing. The same names are converted many
+     * times for the .cpp and .pyi files, so each conversion is done once and
+     * kept for the lifetime of the process. This may be called concurrently.
      */
-    void write_lower_snake_case_python_identifier(
-        writer& w, std::string_view const& name)
+    std::string const& get_identifier(
+        std::string_view const& name, identifier_casing casing)
     {
-        auto identifier = w.write_temp("%", bind<write_lower_snake_case>(name));
+        using identifier_map = std::map<std::string, std::string, std::less<>>;
 
-        w.write(identifier);
+        static std::shared_mutex lock;
+        static identifier_map
+            identifiers[static_cast<size_t>(identifier_casing::count)];
 
-        std::vector<std::string> keywords{
-            "and",      "as",       "assert", "async", "await",  "break",  "class",
-            "continue", "def",      "del",    "elif",  "else",   "except", "finally",
-            "for",      "from",     "global", "if",    "import", "in",     "is",
-            "lambda",   "nonlocal", "not",    "or",    "pass",   "raise",  "return",
-            "try",      "while",    "with",   "yield",
-        };
+        auto& map = identifiers[static_cast<size_t>(casing)];
 
-        // add trailing underscore to avoid keyword clashes
-        if (std::find(keywords.begin(), keywords.end(), identifier) != keywords.end())
         {
-            w.write("_");
+            std::shared_lock read_lock{lock};
+            auto it = map.find(name);
+
+            if (it != map.end())
+            {
+                return it->second;
+            }
         }
+
+        std::string identifier;
+
+        switch (casing)
+        {
+        case identifier_casing::upper_snake_case:
+            identifier = to_snake_case(
+                name,
+                [](char c)
+                {
+                    return static_cast<char>(::toupper(c));
+                });
+            break;
+        case identifier_casing::lower_snake_case:
+            identifier = to_snake_case(
+                name,
+                [](char c)
+                {
+                    return static_cast<char>(::tolower(c));
+                });
+            break;
+        default:
+            identifier = get_identifier(name, identifier_casing::lower_snake_case);
+
+            // add trailing underscore to avoid keyword clashes
+            if (is_python_keyword(identifier))
+            {
+                identifier += '_';
+            }
+            break;
+        }
+
+        std::unique_lock write_lock{lock};
+        return map.try_emplace(std::string{name}, std::move(identifier)).first->second;
+    }
+
+    void write_upper_snake_case(writer& w, std::string_view const& name)
+    {
+        w.write(get_identifier(name, identifier_casing::upper_snake_case));
+    }
+
+    void write_lower_snake_case(writer& w, std::string_view const& name)
+    {
+        w.write(get_identifier(name, identifier_casing::lower_snake_case));
+    }
+
+    /**
+     * Converts @p name to lower_snake_case and adds a trailing underscore if
+     * @p name is a Python keyword.
+     */
+    void write_lower_snake_case_python_identifier(
+        writer& w, std::string_view const& name)
+    {
+        w.write(get_identifier(name, identifier_casing::python_identifier));
     }
 
     void write_lower_case(writer& w, std::string_view const& ns)
@@ -179,11 +286,11 @@ namespace pywinrt
     {
         if (w.current_namespace != ns)
         {
-            auto format = R"(
+            auto format = PYWINRT_FORMAT(R"(
 #if __has_include("py.%.h")
 #include "py.%.h"
 #endif
-)";
+)");
             w.write(format, ns, ns);
         }
         else
@@ -192,6 +299,20 @@ namespace pywinrt
         }
     }
 
+    /**
+     * Writes an include of the forward declaration header of another namespace,
+     * for a namespace that doesn't use its delegates or parameterized types.
+     */
+    void write_fwd_include(writer& w, std::string_view const& ns)
+    {
+        auto format = PYWINRT_FORMAT(R"(
+#if __has_include("py.%.fwd.h")
+#include "py.%.fwd.h"
+#endif
+)");
+        w.write(format, ns, ns);
+    }
+
     // All generated try/catch blocks go thru this function in order to have a single
     // place to change as we test the binary size of different approaches
     void write_try_catch(
@@ -205,25 +326,25 @@ namespace pywinrt
             tryfunc(w);
         }
         w.write(
-            R"(}
+            PYWINRT_FORMAT(R"(}
 catch (...)
 {
     py::to_PyErr();
     return %;
 }
-)",
+)"),
             exception_return_value);
     }
 
     void write_setter_try_catch(writer& w, std::function<void(writer&)> tryfunc)
     {
-        w.write(R"(if (arg == nullptr)
+        w.write(PYWINRT_FORMAT(R"(if (arg == nullptr)
 {
     PyErr_SetString(PyExc_AttributeError, "can't delete attribute");
     return -1;
 }
 
-)");
+)"));
         write_try_catch(
             w,
             [&](writer& w)
@@ -286,13 +407,13 @@ catch (...)
             return;
         }
 
-        auto format = R"(
+        auto format = PYWINRT_FORMAT(R"(
 template<>
 struct py_type<%>
 {
     static PyObject* get_python_type() noexcept;
 };
-)";
+)");
         w.write(format, bind<write_python_wrapper_template_type>(type));
     }
 
@@ -306,7 +427,7 @@ struct py_type<%>
             return;
         }
 
-        auto format = R"(
+        auto format = PYWINRT_FORMAT(R"(
 PyObject* py::py_type<%>::get_python_type() noexcept {
     using namespace py::cpp::%;
 
@@ -329,7 +450,7 @@ PyObject* py::py_type<%>::get_python_type() noexcept {
 
     return python_type;
 }
-)";
+)");
 
         w.write(
             format,
@@ -355,13 +476,13 @@ PyObject* py::py_type<%>::get_python_type() noexcept {
             return;
         }
 
-        auto format = R"(
+        auto format = PYWINRT_FORMAT(R"(
 template<>
 struct winrt_type<%>
 {
     static PyTypeObject* get_python_type() noexcept;
 };
-)";
+)");
         w.write(format, bind<write_python_wrapper_template_type>(type));
     }
 
@@ -380,7 +501,7 @@ struct winrt_type<%>
             return;
         }
 
-        auto format = R"(
+        auto format = PYWINRT_FORMAT(R"(
 PyTypeObject* py::winrt_type<%>::get_python_type() noexcept {
     using namespace py::cpp::%;
 
@@ -403,7 +524,7 @@ PyTypeObject* py::winrt_type<%>::get_python_type() noexcept {
 
     return python_type;
 }
-)";
+)");
 
         w.write(
             format,
@@ -506,8 +627,7 @@ PyTypeObject* py::winrt_type<%>::get_python_type() noexcept {
         {
             writer::indent_guard g{w};
 
-            settings.filter.bind_each<write_ns_module_register_py_type_method_def>(
-                members.enums)(w);
+            bind_each<write_ns_module_register_py_type_method_def>(members.enums)(w);
 
             w.write("{}};\n\n");
         }
@@ -624,13 +744,10 @@ PyTypeObject* py::winrt_type<%>::get_python_type() noexcept {
         {
             writer::indent_guard g{w};
 
-            settings.filter.bind_each<write_ns_module_py_type_member>(members.enums)(w);
-            settings.filter.bind_each<write_ns_module_python_type_member>(
-                members.classes)(w);
-            settings.filter.bind_each<write_ns_module_python_type_member>(
-                members.interfaces)(w);
-            settings.filter.bind_each<write_ns_module_python_type_member>(
-                members.structs)(w);
+            bind_each<write_ns_module_py_type_member>(members.enums)(w);
+            bind_each<write_ns_module_python_type_member>(members.classes)(w);
+            bind_each<write_ns_module_python_type_member>(members.interfaces)(w);
+            bind_each<write_ns_module_python_type_member>(members.structs)(w);
         }
         w.write("};\n");
     }
@@ -683,11 +800,10 @@ PyTypeObject* py::winrt_type<%>::get_python_type() noexcept {
             }
             w.write("}\n\n");
 
-            settings.filter.bind_each<write_ns_module_visit_member>(members.enums)(w);
-            settings.filter.bind_each<write_ns_module_visit_member>(members.classes)(w);
-            settings.filter.bind_each<write_ns_module_visit_member>(members.interfaces)(
-                w);
-            settings.filter.bind_each<write_ns_module_visit_member>(members.structs)(w);
+            bind_each<write_ns_module_visit_member>(members.enums)(w);
+            bind_each<write_ns_module_visit_member>(members.classes)(w);
+            bind_each<write_ns_module_visit_member>(members.interfaces)(w);
+            bind_each<write_ns_module_visit_member>(members.structs)(w);
 
             w.write("\nreturn 0;\n");
         }
@@ -732,11 +848,10 @@ PyTypeObject* py::winrt_type<%>::get_python_type() noexcept {
             }
             w.write("}\n\n");
 
-            settings.filter.bind_each<write_ns_module_clear_member>(members.enums)(w);
-            settings.filter.bind_each<write_ns_module_clear_member>(members.classes)(w);
-            settings.filter.bind_each<write_ns_module_clear_member>(members.interfaces)(
-                w);
-            settings.filter.bind_each<write_ns_module_clear_member>(members.structs)(w);
+            bind_each<write_ns_module_clear_member>(members.enums)(w);
+            bind_each<write_ns_module_clear_member>(members.classes)(w);
+            bind_each<write_ns_module_clear_member>(members.interfaces)(w);
+            bind_each<write_ns_module_clear_member>(members.structs)(w);
 
             w.write("\nreturn 0;\n");
         }
@@ -748,7 +863,7 @@ PyTypeObject* py::winrt_type<%>::get_python_type() noexcept {
      */
     void write_ns_module_def_struct(writer& w, std::string_view const& ns)
     {
-        auto format = R"(
+        auto format = PYWINRT_FORMAT(R"(
 static PyModuleDef module_def
     = {PyModuleDef_HEAD_INIT,
        "%",
@@ -760,7 +875,7 @@ static PyModuleDef module_def
        module_clear,
        nullptr};
 
-)";
+)");
 
         w.write(format, bind<write_ns_module_name>(ns));
     }
@@ -922,12 +1037,9 @@ static PyModuleDef module_def
                 "auto state = reinterpret_cast<module_state*>(PyModule_GetState(module.get()));\n");
             w.write("assert(state);\n\n");
 
-            settings.filter.bind_each<write_ns_module_init_python_type>(
-                members.classes)(w);
-            settings.filter.bind_each<write_ns_module_init_python_type>(
-                members.interfaces)(w);
-            settings.filter.bind_each<write_ns_module_init_python_type>(
-                members.structs)(w);
+            bind_each<write_ns_module_init_python_type>(members.classes)(w);
+            bind_each<write_ns_module_init_python_type>(members.interfaces)(w);
+            bind_each<write_ns_module_init_python_type>(members.structs)(w);
             w.write("\nreturn module.detach();\n");
         }
         w.write("}\n");
@@ -1146,7 +1258,8 @@ static PyModuleDef module_def
             }
         };
 
-        method_signature signature{method};
+        auto const& info = get_method_info(method);
+        auto const& signature = info.signature;
 
         // convert in params from Python -> C++
         for (auto&& param : signature.params())
@@ -1159,7 +1272,7 @@ static PyModuleDef module_def
         }
 
         // Invoke member - simplified code path for methods w/ no out params
-        if (count_py_out_param(signature.params()) == 0)
+        if (info.py_out_params.empty())
         {
             if (signature.return_signature())
             {
@@ -1204,12 +1317,12 @@ static PyModuleDef module_def
         if (signature.return_signature() || is_constructor(method))
         {
             auto format
-                = R"(py::pyobj_handle out_return_value{ py::convert(return_value) };
+                = PYWINRT_FORMAT(R"(py::pyobj_handle out_return_value{ py::convert(return_value) };
 if (!out_return_value)
 {
     return nullptr;
 }
-)";
+)");
             w.write(format);
             return_values.push_back("out_return_value");
         }
@@ -1224,12 +1337,12 @@ if (!out_return_value)
             auto sequence = param.first.Sequence() - 1;
             auto out_param = w.write_temp("out%", sequence);
 
-            auto format = R"(py::pyobj_handle %{ py::convert(param%) };
+            auto format = PYWINRT_FORMAT(R"(py::pyobj_handle %{ py::convert(param%) };
 if (!%)
 {
     return nullptr;
 }
-)";
+)");
             w.write(format, out_param, sequence, out_param);
             return_values.push_back(out_param);
         }
@@ -1268,24 +1381,23 @@ if (!%)
             }
             else
             {
-                w.write(R"(if (kwds != nullptr)
+                w.write(PYWINRT_FORMAT(R"(if (kwds != nullptr)
 {
     py::set_invalid_kwd_args_error();
     return nullptr;
 }
 
 auto arg_count = PyTuple_Size(args);
-)");
+)"));
 
                 separator s{w, "else "};
                 for (auto&& ctor : constructors)
                 {
-                    method_signature signature{ctor};
+                    auto const& info = get_method_info(ctor);
+                    auto const& signature = info.signature;
 
                     s();
-                    w.write(
-                        "if (arg_count == %)\n{\n",
-                        count_py_in_param(signature.params()));
+                    w.write("if (arg_count == %)\n{\n", info.py_in_params.size());
                     {
                         writer::indent_guard g2{w};
                         write_try_catch(
@@ -1312,12 +1424,12 @@ auto arg_count = PyTuple_Size(args);
                     w.write("}\n");
                 }
 
-                w.write(R"(else
+                w.write(PYWINRT_FORMAT(R"(else
 {
     py::set_invalid_arg_count_error(arg_count);
     return nullptr;
 }
-)");
+)"));
             }
         }
         w.write("}\n");
@@ -1329,13 +1441,13 @@ auto arg_count = PyTuple_Size(args);
 
         if (category == category::interface_type)
         {
-            auto format = R"(
+            auto format = PYWINRT_FORMAT(R"(
 static PyObject* _new_@(PyTypeObject* /* unused */, PyObject* /* unused */, PyObject* /* unused */) noexcept
 {
     py::set_invalid_activation_error(type_name_@);
     return nullptr;
 }
-)";
+)");
             w.write(format, type.TypeName(), type.TypeName());
         }
         else if (category == category::class_type)
@@ -1350,54 +1462,51 @@ static PyObject* _new_@(PyTypeObject* /* unused */, PyObject* /* unused */, PyOb
         w.write("auto arg_count = PyTuple_Size(args);\n\n");
         separator s{w, "else "};
 
-        enumerate_methods(
+        enumerate_method_overloads(
             w,
             type,
+            method_name,
             [&](auto const& method)
             {
-                if (method.Name() == method_name)
+                auto const& info = get_method_info(method);
+                auto const& signature = info.signature;
+
+                s();
+                w.write("if (arg_count == %)\n{\n", info.py_in_params.size());
                 {
-                    method_signature signature{method};
+                    writer::indent_guard g{w};
 
-                    s();
                     w.write(
-                        "if (arg_count == %)\n{\n",
-                        count_py_in_param(signature.params()));
+                        "if (!winrt::Windows::Foundation::Metadata::ApiInformation::IsMethodPresent(L\"%.%\", L\"%\", %))\n{\n",
+                        method.Parent().TypeNamespace(),
+                        method.Parent().TypeName(),
+                        method.Name(),
+                        info.in_param_count);
                     {
-                        writer::indent_guard g{w};
-
+                        writer::indent_guard gg{w};
                         w.write(
-                            "if (!winrt::Windows::Foundation::Metadata::ApiInformation::IsMethodPresent(L\"%.%\", L\"%\", %))\n{\n",
-                            method.Parent().TypeNamespace(),
-                            method.Parent().TypeName(),
-                            method.Name(),
-                            count_in_param(signature.params()));
-                        {
-                            writer::indent_guard gg{w};
-                            w.write(
-                                "py::set_arg_count_version_error(%);\n",
-                                count_in_param(signature.params()));
-                            w.write("return nullptr;\n");
-                        }
-                        w.write("}\n\n");
-
-                        write_try_catch(
-                            w,
-                            [&](writer& w)
-                            {
-                                write_method_body_contents(w, type, method);
-                            });
+                            "py::set_arg_count_version_error(%);\n",
+                            info.in_param_count);
+                        w.write("return nullptr;\n");
                     }
-                    w.write("}\n");
+                    w.write("}\n\n");
+
+                    write_try_catch(
+                        w,
+                        [&](writer& w)
+                        {
+                            write_method_body_contents(w, type, method);
+                        });
                 }
+                w.write("}\n");
             });
 
-        w.write(R"(else
+        w.write(PYWINRT_FORMAT(R"(else
 {
     py::set_invalid_arg_count_error(arg_count);
     return nullptr;
 }
-)");
+)"));
     }
 
     /**
@@ -1631,7 +1740,7 @@ static PyObject* _new_@(PyTypeObject* /* unused */, PyObject* /* unused */, PyOb
             w,
             [&](writer& w)
             {
-                auto format = R"(if (%HasCurrent())
+                auto format = PYWINRT_FORMAT(R"(if (%HasCurrent())
 {
     auto cur = %Current();
     %MoveNext();
@@ -1640,7 +1749,7 @@ static PyObject* _new_@(PyTypeObject* /* unused */, PyObject* /* unused */, PyOb
 else
 {
     return nullptr;
-})";
+})");
                 w.write(
                     format,
                     bind<write_method_invoke_context>(type, MethodDef{}),
@@ -1678,23 +1787,21 @@ else
     void write_seq_subscript_body(writer& w, TypeDef const& type)
     {
         std::string collection_type{};
-        enumerate_methods(
+        enumerate_method_overloads(
             w,
             type,
+            "GetAt",
             [&](MethodDef const& method)
             {
-                if (method.Name() == "GetAt")
-                {
-                    collection_type
-                        = w.write_temp("%", method.Signature().ReturnType().Type());
-                }
+                collection_type
+                    = w.write_temp("%", method.Signature().ReturnType().Type());
             });
 
         auto seq_item_invoke
             = is_ptype(type) ? "seq_item(i)"
                              : w.write_temp("_seq_item_@(self, i)", type.TypeName());
 
-        auto format = R"(if (PyIndex_Check(slice))
+        auto format = PYWINRT_FORMAT(R"(if (PyIndex_Check(slice))
 {
     pyobj_handle index{PyNumber_Index(slice)};
 
@@ -1752,7 +1859,7 @@ if (count != length)
     return nullptr;
 }
 
-return convert(items);)";
+return convert(items);)");
 
         write_try_catch(
             w,
@@ -1771,16 +1878,14 @@ return convert(items);)";
     void write_seq_assign_body(writer& w, TypeDef const& type)
     {
         std::string collection_type{};
-        enumerate_methods(
+        enumerate_method_overloads(
             w,
             type,
+            "GetAt",
             [&](MethodDef const& method)
             {
-                if (method.Name() == "GetAt")
-                {
-                    collection_type
-                        = w.write_temp("%", method.Signature().ReturnType().Type());
-                }
+                collection_type
+                    = w.write_temp("%", method.Signature().ReturnType().Type());
             });
 
         write_try_catch(
@@ -1788,10 +1893,11 @@ return convert(items);)";
             [&](writer& w)
             {
                 w.write(
-                    R"(if (value == nullptr) { %RemoveAt(static_cast<uint32_t>(i)); }
+                    PYWINRT_FORMAT(
+                        R"(if (value == nullptr) { %RemoveAt(static_cast<uint32_t>(i)); }
 else { %SetAt(static_cast<uint32_t>(i), py::convert_to<%>(value)); }
 return 0;
-)",
+)"),
                     bind<write_method_invoke_context>(type, MethodDef{}),
                     bind<write_method_invoke_context>(type, MethodDef{}),
                     collection_type);
@@ -1802,17 +1908,14 @@ return 0;
     void write_map_contains_body(writer& w, TypeDef const& type)
     {
         std::string key_type{};
-        enumerate_methods(
+        enumerate_method_overloads(
             w,
             type,
+            "HasKey",
             [&](MethodDef const& method)
             {
-                if (method.Name() == "HasKey")
-                {
-                    method_signature signature{method};
-                    key_type
-                        = w.write_temp("%", signature.params().at(0).second->Type());
-                }
+                auto const& signature = get_method_info(method).signature;
+                key_type = w.write_temp("%", signature.params().at(0).second->Type());
             });
 
         write_try_catch(
@@ -1846,17 +1949,14 @@ return 0;
     void write_map_subscript_body(writer& w, TypeDef const& type)
     {
         std::string key_type{};
-        enumerate_methods(
+        enumerate_method_overloads(
             w,
             type,
+            "Lookup",
             [&](MethodDef const& method)
             {
-                if (method.Name() == "Lookup")
-                {
-                    method_signature signature{method};
-                    key_type
-                        = w.write_temp("%", signature.params().at(0).second->Type());
-                }
+                auto const& signature = get_method_info(method).signature;
+                key_type = w.write_temp("%", signature.params().at(0).second->Type());
             });
 
         write_try_catch(
@@ -1890,18 +1990,15 @@ return 0;
     void write_map_assign_body(writer& w, TypeDef const& type)
     {
         std::string key_type, value_type{};
-        enumerate_methods(
+        enumerate_method_overloads(
             w,
             type,
+            "Lookup",
             [&](MethodDef const& method)
             {
-                if (method.Name() == "Lookup")
-                {
-                    method_signature signature{method};
-                    key_type
-                        = w.write_temp("%", signature.params().at(0).second->Type());
-                    value_type = w.write_temp("%", signature.return_signature().Type());
-                }
+                auto const& signature = get_method_info(method).signature;
+                key_type = w.write_temp("%", signature.params().at(0).second->Type());
+                value_type = w.write_temp("%", signature.return_signature().Type());
             });
 
         write_try_catch(
@@ -2032,8 +2129,8 @@ return 0;
                     [&](writer& w)
                     {
                         auto format
-                            = "auto return_value = py::convert_to<winrt::Windows::Foundation::IInspectable>(arg);\nreturn "
-                              "py::convert(return_value.as<%>());\n";
+                            = PYWINRT_FORMAT("auto return_value = py::convert_to<winrt::Windows::Foundation::IInspectable>(arg);\nreturn "
+                              "py::convert(return_value.as<%>());\n");
                         w.write(format, type);
                     });
             }
@@ -2580,7 +2677,7 @@ return 0;
                   ? "0"
                   : w.write_temp("sizeof(%)", bind<write_pywrapper_type>(type));
 
-        auto format = R"(
+        auto format = PYWINRT_FORMAT(R"(
 static PyType_Spec type_spec_@ =
 {
     "%.@",
@@ -2589,7 +2686,7 @@ static PyType_Spec type_spec_@ =
     Py_TPFLAGS_DEFAULT,
     _type_slots_@
 };
-)";
+)");
         auto type_name = type.TypeName();
         w.write(
             format,
@@ -2658,7 +2755,7 @@ static PyType_Spec type_spec_@ =
 
         w.write("};\n");
 
-        auto format = R"(
+        auto format = PYWINRT_FORMAT(R"(
 static PyType_Spec type_spec_@_Meta =
 {
     "%.@_Meta",
@@ -2667,7 +2764,7 @@ static PyType_Spec type_spec_@_Meta =
     Py_TPFLAGS_DEFAULT,
     type_slots_@_Meta
 };
-)";
+)");
 
         w.write(
             format,
@@ -2771,14 +2868,14 @@ static PyType_Spec type_spec_@_Meta =
         if (!is_ptype(type))
             return;
 
-        auto format = R"(template <%>
+        auto format = PYWINRT_FORMAT(R"(template <%>
 struct pinterface_python_type<%<%>>
 {
     using abstract = %;
     using concrete = %<%>;
 };
 
-)";
+)");
         w.write(
             format,
             bind_list<write_template_arg>(", ", type.GenericParam()),
@@ -2789,6 +2886,18 @@ struct pinterface_python_type<%<%>>
             bind_list<write_template_arg_name>(", ", type.GenericParam()));
     }
 
+    /**
+     * Writes the forward declaration of the abstract wrapper of a parameterized
+     * interface, which is only defined in the full header.
+     */
+    void write_pinterface_forward_decl(writer& w, TypeDef const& type)
+    {
+        if (!is_ptype(type))
+            return;
+
+        w.write("struct @;\n", type.TypeName());
+    }
+
     void write_pinterface_decl(writer& w, TypeDef const& type)
     {
         if (!is_ptype(type))
@@ -2895,6 +3004,21 @@ struct pinterface_python_type<%<%>>
         w.write("};\n");
     }
 
+    /**
+     * Writes the forward declaration of the concrete wrapper of a parameterized
+     * interface, which is only defined in the full header.
+     */
+    void write_pinterface_impl_forward_decl(writer& w, TypeDef const& type)
+    {
+        if (!is_ptype(type))
+            return;
+
+        w.write(
+            "template<%>\nstruct @;\n",
+            bind_list<write_template_arg>(", ", type.GenericParam()),
+            type.TypeName());
+    }
+
     void write_pinterface_impl(writer& w, TypeDef const& type)
     {
         if (!is_ptype(type))
@@ -3532,12 +3656,12 @@ struct pinterface_python_type<%<%>>
             type.TypeName());
         {
             writer::indent_guard g{w};
-            w.write(R"(
+            w.write(PYWINRT_FORMAT(R"(
 auto tuple_size = PyTuple_Size(args);
 
 if ((tuple_size == 0) && (kwds == nullptr))
 {
-)");
+)"));
             {
                 writer::indent_guard gg{w};
                 write_try_catch(
@@ -3560,14 +3684,14 @@ if ((tuple_size == 0) && (kwds == nullptr))
             }
 
             {
-                auto format = R"(
+                auto format = PYWINRT_FORMAT(R"(
 static const char* kwlist[] = {%nullptr};
 if (!PyArg_ParseTupleAndKeywords(args, kwds, "%", const_cast<char**>(kwlist)%))
 {
     return nullptr;
 }
 
-)";
+)");
                 w.write(
                     format,
                     bind_each<write_struct_field_keyword>(type.FieldList()),
@@ -3578,7 +3702,7 @@ if (!PyArg_ParseTupleAndKeywords(args, kwds, "%", const_cast<char**>(kwlist)%))
             if (has_custom_conversion(type))
             {
                 auto format
-                    = "% return_value{ };\ncustom_set(return_value, %);\nreturn py::convert(return_value);\n";
+                    = PYWINRT_FORMAT("% return_value{ };\ncustom_set(return_value, %);\nreturn py::convert(return_value);\n");
                 write_try_catch(
                     w,
                     [&](writer& w)
@@ -3595,7 +3719,7 @@ if (!PyArg_ParseTupleAndKeywords(args, kwds, "%", const_cast<char**>(kwlist)%))
                 auto ref_captures = w.write_temp(
                     "%", bind_each<write_struct_field_ref_capture>(type.FieldList()));
                 auto format
-                    = "% return_value{ % };\nreturn py::convert(return_value);\n";
+                    = PYWINRT_FORMAT("% return_value{ % };\nreturn py::convert(return_value);\n");
                 write_try_catch(
                     w,
                     [&](writer& w)
@@ -3745,7 +3869,7 @@ if (!PyArg_ParseTupleAndKeywords(args, kwds, "%", const_cast<char**>(kwlist)%))
         {
             writer::indent_guard g{w};
 
-            auto format = R"(throw_if_pyobj_null(obj);
+            auto format = PYWINRT_FORMAT(R"(throw_if_pyobj_null(obj);
 
 auto type =  py::get_python_type<%>();
 
@@ -3760,7 +3884,7 @@ if (Py_TYPE(obj) == type)
 
 PyErr_SetString(PyExc_TypeError, "expecting %");
 throw python_exception();
-)";
+)");
             w.write(format, type, type, type);
         }
         w.write("}");
@@ -3799,13 +3923,13 @@ throw python_exception();
 
     void write_delegate_type_mapper(writer& w, TypeDef const& type)
     {
-        auto format = R"(template <%>
+        auto format = PYWINRT_FORMAT(R"(template <%>
 struct delegate_python_type<%%>
 {
     using type = %%;
 };
 
-)";
+)");
         w.write(
             format,
             bind_list<write_template_arg>(", ", type.GenericParam()),
@@ -3820,12 +3944,28 @@ struct delegate_python_type<%%>
         w.write("auto %", bind<write_param_name>(p));
     }
 
+    /**
+     * Writes the forward declaration of the callable wrapper of a delegate,
+     * which is only defined in the full header.
+     */
+    void write_delegate_callable_wrapper_forward_decl(writer& w, TypeDef const& type)
+    {
+        if (is_ptype(type))
+        {
+            w.write(
+                "template<%>\n",
+                bind_list<write_template_arg>(", ", type.GenericParam()));
+        }
+
+        w.write("struct @;\n", type.TypeName());
+    }
+
     void write_delegate_callable_wrapper(writer& w, TypeDef const& type)
     {
         auto guard{w.push_generic_params(type.GenericParam())};
 
         auto invoke = get_delegate_invoke(type);
-        method_signature signature{invoke};
+        auto const& signature = get_method_info(invoke).signature;
 
         if (is_ptype(type))
         {
@@ -3846,11 +3986,11 @@ struct delegate_python_type<%%>
                 writer::indent_guard gg{w};
 
                 {
-                    auto format = R"(py::delegate_callable _delegate{ callable };
+                    auto format = PYWINRT_FORMAT(R"(py::delegate_callable _delegate{ callable };
 
 return [delegate = std::move(_delegate)](%)
 {
-)";
+)");
                     w.write(
                         format,
                         bind_list<write_delegate_param>(", ", signature.params()));
@@ -3893,7 +4033,7 @@ return [delegate = std::move(_delegate)](%)
                         w.write("py::pyobj_handle args{ nullptr };\n");
                     }
 
-                    w.write(
+                    w.write(PYWINRT_FORMAT(
                         R"(py::pyobj_handle return_value{ PyObject_CallObject(delegate.callable(), args.get()) };
 
 if (!return_value)
@@ -3901,7 +4041,7 @@ if (!return_value)
     PyErr_WriteUnraisable(delegate.callable());
     throw winrt::hresult_error();
 }
-)");
+)"));
 
                     if (signature.return_signature())
                     {
@@ -4190,9 +4330,11 @@ if (!return_value)
      * If a method has out parameters, the return type is a tuple that includes
      * those types in addition to the return type.
      */
-    void write_return_typing(writer& w, method_signature& signature)
+    void write_return_typing(writer& w, method_info const& info)
     {
-        if (count_py_out_param(signature.params()) == 0)
+        auto const& signature = info.signature;
+
+        if (info.py_out_params.empty())
         {
             if (signature.return_signature())
             {
@@ -4214,24 +4356,22 @@ if (!return_value)
                     "typing.Tuple[%, %]",
                     bind<write_nullable_python_type>(
                         signature.return_signature().Type()),
-                    bind_list<write_method_out_param_typing>(
-                        ", ", filter_py_out_params(signature.params())));
+                    bind_list<write_method_out_param_typing>(", ", info.py_out_params));
             }
             else
             {
-                if (count_py_out_param(signature.params()) == 1)
+                if (info.py_out_params.size() == 1)
                 {
                     w.write(
                         "%",
-                        bind<write_method_out_param_typing>(
-                            filter_py_out_params(signature.params())[0]));
+                        bind<write_method_out_param_typing>(info.py_out_params[0]));
                 }
                 else
                 {
                     w.write(
                         "typing.Tuple[%]",
                         bind_list<write_method_out_param_typing>(
-                            ", ", filter_py_out_params(signature.params())));
+                            ", ", info.py_out_params));
                 }
             }
         }
@@ -4317,8 +4457,8 @@ if (!return_value)
      * Note: only interfaces and delegates currently can be parameterized.
      *
      * @param w The writer
-     * @param interfaces The list of interfaces.
-     * @param delegates The list of delegates.
+     * @param interfaces The list of interfaces, already filtered.
+     * @param delegates The list of delegates, already filtered.
      */
     void write_python_type_vars(
         writer& w,
@@ -4328,14 +4468,9 @@ if (!return_value)
         std::set<std::string> params;
 
         // filter function to add generic type params only if they are not
-        // excluded, private or non-generic
+        // private or non-generic
         auto add_param = [&w, &params](TypeDef const& type)
         {
-            if (!settings.filter.includes(type))
-            {
-                return;
-            }
-
             if (is_exclusive_to(type))
             {
                 return;
@@ -4716,7 +4851,8 @@ if (!return_value)
 
             auto method_writer = [&](MethodDef const& method)
             {
-                method_signature signature{method};
+                auto const& info = get_method_info(method);
+                auto const& signature = info.signature;
 
                 if (is_method_overloaded(w, type, method.Name()))
                 {
@@ -4730,9 +4866,7 @@ if (!return_value)
 
                 // seperator between cls/self and the rest of the args
                 auto first_seperator
-                    = !is_static(method) && count_py_in_param(signature.params()) > 0
-                          ? ", "
-                          : "";
+                    = !is_static(method) && info.py_in_params.size() > 0 ? ", " : "";
 
                 // TODO: add trailing ", /" (PEP 570) to the parameters when we drop
                 // support for Python 3.7
@@ -4743,7 +4877,7 @@ if (!return_value)
                         type.TypeName(),
                         first_seperator,
                         bind_list<write_method_in_param_name_and_typing>(
-                            ", ", filter_py_in_params(signature.params())),
+                            ", ", info.py_in_params),
                         type.TypeName());
                 }
                 else
@@ -4754,8 +4888,8 @@ if (!return_value)
                         is_static(method) ? "" : "self",
                         first_seperator,
                         bind_list<write_method_in_param_name_and_typing>(
-                            ", ", filter_py_in_params(signature.params())),
-                        bind<write_return_typing>(signature));
+                            ", ", info.py_in_params),
+                        bind<write_return_typing>(info));
                 }
             };
 
@@ -4796,13 +4930,12 @@ if (!return_value)
 
         auto guard{w.push_generic_params(type.GenericParam())};
 
-        method_signature signature{get_delegate_invoke(type)};
+        auto const& info = get_method_info(get_delegate_invoke(type));
 
         w.write(
             "@ = typing.Callable[[%], %]\n\n",
             type.TypeName(),
-            bind_list<write_method_in_param_typing>(
-                ", ", filter_py_in_params(signature.params())),
-            bind<write_return_typing>(signature));
+            bind_list<write_method_in_param_typing>(", ", info.py_in_params),
+            bind<write_return_typing>(info));
     }
 } // namespace pywinrt
@@ -12,47 +12,58 @@ namespace pywinrt
         w.flush_to_file(folder / "pybase.h");
     }
 
-    inline void write_namespace_h(
+    /**
+     * Writes py.<ns>.fwd.h, which declares the Python types, converters and
+     * type mappers of the namespace. Namespaces that don't use its delegates,
+     * parameterized types or required interfaces include this instead of
+     * py.<ns>.h. It only needs the C++/WinRT declarations of the namespace, so
+     * it includes <winrt/impl/<ns>.0.h> rather than the full <winrt/<ns>.h>.
+     */
+    inline void write_namespace_fwd_h(
         stdfs::path const& folder,
         std::string_view const& ns,
-        std::set<std::string> const& needed_namespaces,
         cache::namespace_members const& members)
     {
         writer w;
         w.current_namespace = ns;
 
-        for (auto&& needed_ns : needed_namespaces)
+        auto filename = w.write_temp("py.%.fwd.h", ns);
+
+        auto segments = get_dotted_name_segments(ns);
+
+        write_license(w);
         {
-            w.needed_namespaces.insert(needed_ns);
-        }
+            auto format = PYWINRT_FORMAT(R"(#pragma once
 
-        auto filename = w.write_temp("py.%.h", ns);
+#include "pybase.h"
 
-        auto segments = get_dotted_name_segments(ns);
+#include <winrt/impl/%.0.h>
+)");
+            w.write(format, ns);
+        }
 
-        w.write("\nnamespace py::proj::%\n{", bind_list("::", segments));
+        w.write("\nnamespace py::proj::%\n{\n", bind_list("::", segments));
         {
             writer::indent_guard g{w};
-            settings.filter.bind_each<write_pinterface_decl>(members.interfaces)(w);
+            bind_each<write_pinterface_forward_decl>(members.interfaces)(w);
         }
         w.write("}\n");
 
-        w.write("\nnamespace py::impl::%\n{", bind_list("::", segments));
+        w.write("\nnamespace py::impl::%\n{\n", bind_list("::", segments));
         {
             writer::indent_guard g{w};
-            settings.filter.bind_each<write_delegate_callable_wrapper>(
-                members.delegates)(w);
-            settings.filter.bind_each<write_pinterface_impl>(members.interfaces)(w);
+            bind_each<write_delegate_callable_wrapper_forward_decl>(members.delegates)(
+                w);
+            bind_each<write_pinterface_impl_forward_decl>(members.interfaces)(w);
         }
         w.write("}\n");
 
         w.write("\nnamespace py::wrapper::%\n{\n", bind_list("::", segments));
         {
             writer::indent_guard g{w};
-            settings.filter.bind_each<write_python_wrapper_alias>(members.classes)(w);
-            settings.filter.bind_each<write_python_wrapper_alias>(members.interfaces)(
-                w);
-            settings.filter.bind_each<write_python_wrapper_alias>(members.structs)(w);
+            bind_each<write_python_wrapper_alias>(members.classes)(w);
+            bind_each<write_python_wrapper_alias>(members.interfaces)(w);
+            bind_each<write_python_wrapper_alias>(members.structs)(w);
         }
         w.write("}\n");
 
@@ -60,40 +71,83 @@ namespace pywinrt
         {
             writer::indent_guard g{w};
 
-            settings.filter.bind_each<write_struct_buffer_format_decl>(members.structs)(w);
-            settings.filter.bind_each<write_py_type_specialization_struct>(
-                members.enums)(w);
-            settings.filter.bind_each<write_python_type_specialization_struct>(
-                members.classes)(w);
-            settings.filter.bind_each<write_python_type_specialization_struct>(
-                members.interfaces)(w);
-            settings.filter.bind_each<write_python_type_specialization_struct>(
-                members.structs)(w);
-            settings.filter.bind_each<write_pinterface_type_mapper>(members.interfaces)(
-                w);
-            settings.filter.bind_each<write_delegate_type_mapper>(members.delegates)(w);
-            settings.filter.bind_each<write_struct_converter_decl>(members.structs)(w);
+            bind_each<write_struct_buffer_format_decl>(members.structs)(w);
+            bind_each<write_py_type_specialization_struct>(members.enums)(w);
+            bind_each<write_python_type_specialization_struct>(members.classes)(w);
+            bind_each<write_python_type_specialization_struct>(members.interfaces)(w);
+            bind_each<write_python_type_specialization_struct>(members.structs)(w);
+            bind_each<write_pinterface_type_mapper>(members.interfaces)(w);
+            bind_each<write_delegate_type_mapper>(members.delegates)(w);
+            bind_each<write_struct_converter_decl>(members.structs)(w);
         }
         w.write("}\n");
 
-        w.swap();
+        w.flush_to_file(folder / filename);
+    }
 
-        write_license(w);
+    /**
+     * Writes py.<ns>.h, which defines the delegate and parameterized interface
+     * wrappers of the namespace on top of py.<ns>.fwd.h, and includes the full
+     * C++/WinRT headers of the namespace and its full_headers dependencies.
+     */
+    inline void write_namespace_h(
+        stdfs::path const& folder,
+        std::string_view const& ns,
+        namespace_dependencies const& dependencies,
+        cache::namespace_members const& members)
+    {
+        writer w;
+        w.current_namespace = ns;
+        w.needed_namespaces = dependencies.namespaces;
+        w.needed_namespaces |= dependencies.full_headers;
+
+        auto filename = w.write_temp("py.%.h", ns);
+
+        auto segments = get_dotted_name_segments(ns);
+
+        w.write("\nnamespace py::proj::%\n{", bind_list("::", segments));
         {
-            auto format = R"(#pragma once
+            writer::indent_guard g{w};
+            bind_each<write_pinterface_decl>(members.interfaces)(w);
+        }
+        w.write("}\n");
 
-#include "pybase.h"
-)";
-            w.write(format);
+        w.write("\nnamespace py::impl::%\n{", bind_list("::", segments));
+        {
+            writer::indent_guard g{w};
+            bind_each<write_delegate_callable_wrapper>(members.delegates)(w);
+            bind_each<write_pinterface_impl>(members.interfaces)(w);
         }
+        w.write("}\n");
+
+        auto includes = w.needed_namespaces;
 
-        w.write_each<write_include>(w.needed_namespaces);
+        w.swap();
 
+        write_license(w);
         {
-            auto format = R"(
+            auto format = PYWINRT_FORMAT(R"(#pragma once
+
+#include "py.%.fwd.h"
+
 #include <winrt/%.h>
-)";
-            w.write(format, ns);
+)");
+            w.write(format, ns, ns);
+        }
+
+        for (auto&& include : includes)
+        {
+            // a namespace only found while writing the wrappers above is
+            // assumed to need its full header
+            if (dependencies.full_headers.contains(include)
+                || !dependencies.namespaces.contains(include))
+            {
+                write_include(w, include);
+            }
+            else
+            {
+                write_fwd_include(w, include);
+            }
         }
 
         w.flush_to_file(folder / filename);
@@ -107,6 +161,7 @@ namespace pywinrt
         writer w;
         w.current_namespace = ns;
         auto filename = w.write_temp("py.%.cpp", ns);
+        w.stream_to_file(folder / filename);
 
         write_license(w);
         w.write("#include \"pybase.h\"\n");
@@ -116,7 +171,7 @@ namespace pywinrt
         {
             w.write(strings::custom_struct_convert);
         }
-        settings.filter.bind_each<write_struct_convert_functions>(members.structs)(w);
+        bind_each<write_struct_convert_functions>(members.structs)(w);
 
         auto segments = get_dotted_name_segments(ns);
         w.write("\n\nnamespace py::cpp::%\n{", bind_list("::", segments));
@@ -125,22 +180,20 @@ namespace pywinrt
 
             write_namespace_module_state_struct(w, members);
 
-            settings.filter.bind_each<write_py_type_registration_method>(members.enums)(
-                w);
-            settings.filter.bind_each<write_inspectable_type>(members.classes)(w);
-            settings.filter.bind_each<write_inspectable_type>(members.interfaces)(w);
-            settings.filter.bind_each<write_struct>(members.structs)(w);
+            bind_each<write_py_type_registration_method>(members.enums)(w);
+            bind_each<write_inspectable_type>(members.classes)(w);
+            bind_each<write_inspectable_type>(members.interfaces)(w);
+            bind_each<write_struct>(members.structs)(w);
             write_namespace_initialization(w, ns, members);
         }
         w.write("} // py::cpp::%\n", bind_list("::", segments));
 
         write_namespace_module_init_function(w, ns, members);
 
-        settings.filter.bind_each<write_get_py_type_definition>(members.enums)(w);
-        settings.filter.bind_each<write_get_python_type_definition>(members.classes)(w);
-        settings.filter.bind_each<write_get_python_type_definition>(members.interfaces)(
-            w);
-        settings.filter.bind_each<write_get_python_type_definition>(members.structs)(w);
+        bind_each<write_get_py_type_definition>(members.enums)(w);
+        bind_each<write_get_python_type_definition>(members.classes)(w);
+        bind_each<write_get_python_type_definition>(members.interfaces)(w);
+        bind_each<write_get_python_type_definition>(members.structs)(w);
 
         w.flush_to_file(folder / filename);
         return std::move(w.needed_namespaces);
@@ -179,6 +232,154 @@ namespace pywinrt
         w.flush_to_file(folder / filename);
     }
 
+    /**
+     * Removes the files in @p folder whose names start with @p prefix and
+     * aren't in @p filenames.
+     */
+    inline void remove_stale_files(
+        stdfs::path const& folder,
+        std::string_view const& prefix,
+        std::set<std::string> const& filenames)
+    {
+        for (auto&& entry : stdfs::directory_iterator{folder})
+        {
+            auto filename = entry.path().filename().string();
+
+            if (starts_with(filename, prefix) && !contains(filenames, filename))
+            {
+                stdfs::remove(entry.path());
+            }
+        }
+    }
+
+    /**
+     * Writes a unity build file for each group of namespaces and unity.cmake,
+     * which lists them along with the namespace source files that they include,
+     * and removes the unity build files left over from a previous run.
+     */
+    inline void write_unity_files(
+        stdfs::path const& folder, std::vector<namespace_group> const& groups)
+    {
+        std::set<std::string> filenames;
+
+        for (size_t i{}; i < groups.size(); i++)
+        {
+            writer w;
+            write_license(w);
+
+            for (auto&& ns : groups[i].namespaces)
+            {
+                w.write("#include \"../py.%.cpp\"\n", ns);
+            }
+
+            auto filename = w.write_temp("py.unity.%.cpp", static_cast<uint32_t>(i));
+            w.flush_to_file(folder / filename);
+            filenames.insert(filename);
+        }
+
+        writer w;
+        write_license(w, "#");
+        w.write("# The unity build files and the namespace source files that they "
+                "include,\n# which must not also be compiled on their own.\n");
+        w.write("\nset(PYWINRT_UNITY_SOURCES\n");
+
+        for (size_t i{}; i < groups.size(); i++)
+        {
+            w.write("    \"py.unity.%.cpp\"\n", static_cast<uint32_t>(i));
+        }
+
+        w.write(")\n\nset(PYWINRT_UNITY_INCLUDED_SOURCES\n");
+
+        for (size_t i{}; i < groups.size(); i++)
+        {
+            w.write(
+                "    # py.unity.%.cpp (estimated cost: %)\n",
+                static_cast<uint32_t>(i),
+                groups[i].cost);
+
+            for (auto&& ns : groups[i].namespaces)
+            {
+                w.write("    \"py.%.cpp\"\n", ns);
+            }
+        }
+
+        w.write(")\n");
+        w.flush_to_file(folder / "unity.cmake");
+
+        remove_stale_files(folder, "py.unity.", filenames);
+    }
+
+    /**
+     * Writes a precompiled header for each group of namespaces, which includes
+     * the projection header of each namespace in the group, and
+     * pch.cmake, which lists each header along with the source files that are
+     * compiled with it, and removes the headers left over from a previous run.
+     *
+     * When the namespace sources are also grouped into unity build files, the
+     * groups must be the same as the ones passed to write_unity_files().
+     */
+    inline void write_pch_files(
+        stdfs::path const& folder, std::vector<namespace_group> const& groups)
+    {
+        std::set<std::string> filenames;
+
+        for (size_t i{}; i < groups.size(); i++)
+        {
+            writer w;
+            write_license(w);
+            w.write("#pragma once\n\n#include \"../pybase.h\"\n");
+
+            for (auto&& ns : groups[i].namespaces)
+            {
+                w.write("#include \"../py.%.h\"\n", ns);
+            }
+
+            auto filename = w.write_temp("py.pch.%.h", static_cast<uint32_t>(i));
+            w.flush_to_file(folder / filename);
+            filenames.insert(filename);
+        }
+
+        writer w;
+        write_license(w, "#");
+        w.write("# The precompiled header of each group of namespaces and the source "
+                "files,\n# relative to the src folder, that are compiled with it.\n");
+        w.write("\nset(PYWINRT_PCH_GROUPS");
+
+        for (size_t i{}; i < groups.size(); i++)
+        {
+            w.write(" %", static_cast<uint32_t>(i));
+        }
+
+        w.write(")\n");
+
+        for (size_t i{}; i < groups.size(); i++)
+        {
+            auto index = static_cast<uint32_t>(i);
+
+            w.write("\n# estimated cost: %\n", groups[i].cost);
+            w.write("set(PYWINRT_PCH_%_HEADER \"pch/py.pch.%.h\")\n", index, index);
+            w.write("set(PYWINRT_PCH_%_SOURCES\n", index);
+
+            if (settings.unity)
+            {
+                w.write("    \"unity/py.unity.%.cpp\"\n", index);
+            }
+            else
+            {
+                for (auto&& ns : groups[i].namespaces)
+                {
+                    w.write("    \"py.%.cpp\"\n", ns);
+                }
+            }
+
+            w.write(")\n");
+        }
+
+        w.flush_to_file(folder / "pch.cmake");
+
+        remove_stale_files(folder, "py.pch.", filenames);
+    }
+
     void write_namespace_cpp_filename(writer& w, std::string const& ns)
     {
         w.write("\"./%/src/py.%.cpp\"", settings.module, ns);
@@ -212,7 +413,7 @@ namespace pywinrt
     inline void write_namespace_dunder_init_py(
         stdfs::path const& folder,
         std::string_view const& module_name,
-        std::set<std::string> const& needed_namespaces,
+        namespace_set const& needed_namespaces,
         std::string_view const& ns,
         cache::namespace_members const& members)
     {
@@ -221,7 +422,7 @@ namespace pywinrt
 
         write_license(w, "#");
 
-        if (settings.filter.includes(members.enums))
+        if (!members.enums.empty())
         {
             w.write("import enum\n");
             w.write("\n");
@@ -232,29 +433,30 @@ namespace pywinrt
         w.write("\n_ns_module = %.system._import_ns_module(\"%\")\n", module_name, ns);
 
         w.write_each<write_python_try_import_namespace>(needed_namespaces);
-        settings.filter.bind_each<write_python_enum>(members.enums)(w);
+        bind_each<write_python_enum>(members.enums)(w);
         w.write("\n");
-        settings.filter.bind_each<write_py_type_registration>(members.enums)(w);
+        bind_each<write_py_type_registration>(members.enums)(w);
         w.write("\n");
-        settings.filter.bind_each<write_python_import_type>(members.structs)(w);
-        settings.filter.bind_each<write_python_import_type>(members.classes)(w);
-        settings.filter.bind_each<write_python_import_type>(members.interfaces)(w);
+        bind_each<write_python_import_type>(members.structs)(w);
+        bind_each<write_python_import_type>(members.classes)(w);
+        bind_each<write_python_import_type>(members.interfaces)(w);
 
         w.flush_to_file(folder / "__init__.py");
     }
 
     inline void write_namespace_dunder_init_pyi(
         stdfs::path const& folder,
-        std::set<std::string> const& needed_namespaces,
+        namespace_set const& needed_namespaces,
         std::string_view const& ns,
         cache::namespace_members const& members)
     {
         writer w;
         w.current_namespace = ns;
+        w.stream_to_file(folder / "__init__.pyi");
 
         write_license(w, "#");
 
-        if (settings.filter.includes(members.enums))
+        if (!members.enums.empty())
         {
             w.write("import enum\n");
         }
@@ -267,17 +469,16 @@ namespace pywinrt
         w.write("import @.system\n", settings.module);
 
         w.write_each<write_python_import_namespace>(needed_namespaces);
-        settings.filter.bind_each<write_python_enum>(members.enums)(w);
+        bind_each<write_python_enum>(members.enums)(w);
         w.write("\n");
 
         write_python_type_vars(w, members.interfaces, members.delegates);
         w.write("\n");
 
-        settings.filter.bind_each<write_python_typing_for_struct>(members.structs)(w);
-        settings.filter.bind_each<write_python_typing_for_object>(members.classes)(w);
-        settings.filter.bind_each<write_python_typing_for_object>(members.interfaces)(
-            w);
-        settings.filter.bind_each<write_python_type_alias>(members.delegates)(w);
+        bind_each<write_python_typing_for_struct>(members.structs)(w);
+        bind_each<write_python_typing_for_object>(members.classes)(w);
+        bind_each<write_python_typing_for_object>(members.interfaces)(w);
+        bind_each<write_python_type_alias>(members.delegates)(w);
 
         w.flush_to_file(folder / "__init__.pyi");
     }
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "impl/pywinrt_base.h"
+
+namespace pywinrt
+{
+    /**
+     * A 128-bit non-cryptographic hash.
+     */
+    struct hash_value
+    {
+        uint64_t low{};
+        uint64_t high{};
+
+        bool operator==(hash_value const& other) const noexcept
+        {
+            return low == other.low && high == other.high;
+        }
+
+        bool operator!=(hash_value const& other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * Incrementally computes the 128-bit MurmurHash3 (x64 variant) of a
+     * sequence of bytes. Splitting the input across several calls to update()
+     * gives the same result as passing it all at once.
+     */
+    struct hasher
+    {
+        void update(void const* data, size_t size) noexcept
+        {
+            auto bytes = static_cast<uint8_t const*>(data);
+            m_length += size;
+
+            if (m_pending_size != 0)
+            {
+                auto count = std::min(size, block_size - m_pending_size);
+                std::memcpy(m_pending + m_pending_size, bytes, count);
+                m_pending_size += count;
+                bytes += count;
+                size -= count;
+
+                if (m_pending_size < block_size)
+                {
+                    return;
+                }
+
+                mix_block(m_pending);
+                m_pending_size = 0;
+            }
+
+            for (; size >= block_size; bytes += block_size, size -= block_size)
+            {
+                mix_block(bytes);
+            }
+
+            std::memcpy(m_pending, bytes, size);
+            m_pending_size = size;
+        }
+
+        /**
+         * Adds the length of the string followed by its contents so that
+         * consecutive strings can't run into each other.
+         */
+        void update_string(std::string_view const& value) noexcept
+        {
+            uint64_t size = value.size();
+            update(&size, sizeof(size));
+            update(value.data(), value.size());
+        }
+
+        hash_value finish() const noexcept
+        {
+            auto h1 = m_h1;
+            auto h2 = m_h2;
+            uint64_t k1{};
+            uint64_t k2{};
+
+            for (auto i = m_pending_size; i > 8; i--)
+            {
+                k2 = (k2 << 8) | m_pending[i - 1];
+            }
+
+            for (auto i = std::min<size_t>(m_pending_size, 8); i > 0; i--)
+            {
+                k1 = (k1 << 8) | m_pending[i - 1];
+            }
+
+            if (m_pending_size > 8)
+            {
+                h2 ^= rotl(k2 * c2, 33) * c1;
+            }
+
+            if (m_pending_size > 0)
+            {
+                h1 ^= rotl(k1 * c1, 31) * c2;
+            }
+
+            h1 ^= m_length;
+            h2 ^= m_length;
+            h1 += h2;
+            h2 += h1;
+            h1 = fmix(h1);
+            h2 = fmix(h2);
+            h1 += h2;
+            h2 += h1;
+
+            return {h1, h2};
+        }
+
+      private:
+        static constexpr size_t block_size{16};
+        static constexpr uint64_t c1{0x87c37b91114253d5};
+        static constexpr uint64_t c2{0x4cf5ad432745937f};
+
+        static constexpr uint64_t rotl(uint64_t value, int shift) noexcept
+        {
+            return (value << shift) | (value >> (64 - shift));
+        }
+
+        static constexpr uint64_t fmix(uint64_t k) noexcept
+        {
+            k ^= k >> 33;
+            k *= 0xff51afd7ed558ccd;
+            k ^= k >> 33;
+            k *= 0xc4ceb9fe1a85ec53;
+            k ^= k >> 33;
+            return k;
+        }
+
+        void mix_block(uint8_t const* block) noexcept
+        {
+            // the hash is defined for little-endian loads, which is what all
+            // of the platforms supported by the generator use
+            uint64_t k1;
+            uint64_t k2;
+            std::memcpy(&k1, block, sizeof(k1));
+            std::memcpy(&k2, block + sizeof(k1), sizeof(k2));
+
+            m_h1 ^= rotl(k1 * c1, 31) * c2;
+            m_h1 = rotl(m_h1, 27) + m_h2;
+            m_h1 = m_h1 * 5 + 0x52dce729;
+
+            m_h2 ^= rotl(k2 * c2, 33) * c1;
+            m_h2 = rotl(m_h2, 31) + m_h1;
+            m_h2 = m_h2 * 5 + 0x38495ab5;
+        }
+
+        uint64_t m_h1{};
+        uint64_t m_h2{};
+        uint64_t m_length{};
+        uint8_t m_pending[block_size]{};
+        size_t m_pending_size{};
+    };
+
+    inline hash_value hash_bytes(void const* data, size_t size) noexcept
+    {
+        hasher h;
+        h.update(data, size);
+        return h.finish();
+    }
+
+    inline std::string to_string(hash_value const& value)
+    {
+        char buffer[33];
+        std::snprintf(
+            buffer,
+            sizeof(buffer),
+            "%016llx%016llx",
+            static_cast<unsigned long long>(value.high),
+            static_cast<unsigned long long>(value.low));
+        return buffer;
+    }
+
+    /**
+     * Parses a hash that was formatted with to_string().
+     */
+    inline std::optional<hash_value> parse_hash_value(std::string_view const& text)
+    {
+        if (text.size() != 32
+            || !std::all_of(
+                text.begin(),
+                text.end(),
+                [](char c)
+                {
+                    return ::isxdigit(static_cast<unsigned char>(c));
+                }))
+        {
+            return std::nullopt;
+        }
+
+        hash_value value;
+        value.high = std::stoull(std::string{text.substr(0, 16)}, nullptr, 16);
+        value.low = std::stoull(std::string{text.substr(16)}, nullptr, 16);
+        return value;
+    }
+} // namespace pywinrt
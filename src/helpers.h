@@ -345,70 +345,222 @@ namespace pywinrt
         return false;
     }
 
+    /**
+     * Gets an array with one value-initialized T for each of @p row_count rows
+     * of a metadata table in @p db, created on first use. Calls with the same
+     * Tag and database return the same array, which lives until the process
+     * exits. This may be called concurrently.
+     */
+    template<typename Tag, typename T>
+    T* get_database_table(database const& db, size_t row_count)
+    {
+        static std::shared_mutex lock;
+        static std::map<database const*, std::unique_ptr<T[]>> tables;
+
+        // rows from the same database are usually looked up one after another
+        thread_local database const* last_database{};
+        thread_local T* last_table{};
+
+        if (&db == last_database)
+        {
+            return last_table;
+        }
+
+        T* table{};
+
+        {
+            std::shared_lock read_lock{lock};
+            auto it = tables.find(&db);
+
+            if (it != tables.end())
+            {
+                table = it->second.get();
+            }
+        }
+
+        if (!table)
+        {
+            std::unique_lock write_lock{lock};
+            auto& new_table = tables[&db];
+
+            if (!new_table)
+            {
+                new_table = std::make_unique<T[]>(row_count);
+            }
+
+            table = new_table.get();
+        }
+
+        last_database = &db;
+        last_table = table;
+        return table;
+    }
+
+    /**
+     * Interfaces that change how a type is projected.
+     */
+    enum class well_known_interface : uint32_t
+    {
+        IBuffer,
+        IMemoryBufferReference,
+        IStringable,
+        IClosable,
+        IAsyncAction,
+        IAsyncActionWithProgress,
+        IAsyncOperation,
+        IAsyncOperationWithProgress,
+        IIterable,
+        IIterator,
+        IVector,
+        IVectorView,
+        IMap,
+        IMapView,
+        count,
+    };
+
+    using well_known_interface_set
+        = std::bitset<static_cast<size_t>(well_known_interface::count)>;
+
+    inline constexpr std::pair<std::string_view, std::string_view>
+        well_known_interface_names[]{
+            {"Windows.Storage.Streams", "IBuffer"},
+            {"Windows.Foundation", "IMemoryBufferReference"},
+            {"Windows.Foundation", "IStringable"},
+            {"Windows.Foundation", "IClosable"},
+            {"Windows.Foundation", "IAsyncAction"},
+            {"Windows.Foundation", "IAsyncActionWithProgress`1"},
+            {"Windows.Foundation", "IAsyncOperation`1"},
+            {"Windows.Foundation", "IAsyncOperationWithProgress`2"},
+            {"Windows.Foundation.Collections", "IIterable`1"},
+            {"Windows.Foundation.Collections", "IIterator`1"},
+            {"Windows.Foundation.Collections", "IVector`1"},
+            {"Windows.Foundation.Collections", "IVectorView`1"},
+            {"Windows.Foundation.Collections", "IMap`2"},
+            {"Windows.Foundation.Collections", "IMapView`2"},
+        };
+
+    static_assert(
+        std::size(well_known_interface_names)
+        == static_cast<size_t>(well_known_interface::count));
+
+    /**
+     * Gets the well-known interfaces that @p type is or implements, directly
+     * or through other interfaces. The result for each type is computed once
+     * and stored in a per-database table indexed by TypeDef row, so after
+     * the first call for a type this is a single atomic load. This may be
+     * called concurrently.
+     */
+    well_known_interface_set get_implemented_interfaces(TypeDef const& type)
+    {
+        static_assert(static_cast<size_t>(well_known_interface::count) < 32);
+        constexpr uint32_t computed_flag{1u << 31};
+
+        auto const& db = type.get_database();
+        auto& slot = get_database_table<well_known_interface, std::atomic<uint32_t>>(
+            db, db.TypeDef.size())[type.index()];
+        auto value = slot.load(std::memory_order_acquire);
+
+        if (value & computed_flag)
+        {
+            return value & ~computed_flag;
+        }
+
+        well_known_interface_set result;
+
+        if (get_category(type) == category::interface_type)
+        {
+            for (size_t i{}; i < std::size(well_known_interface_names); i++)
+            {
+                auto&& [ns, name] = well_known_interface_names[i];
+
+                if (type.TypeNamespace() == ns && type.TypeName() == name)
+                {
+                    result.set(i);
+                }
+            }
+        }
+
+        for (auto&& ii : type.InterfaceImpl())
+        {
+            result |= get_implemented_interfaces(get_typedef(ii.Interface()));
+        }
+
+        // racing threads compute the same value, so either store is fine
+        slot.store(
+            static_cast<uint32_t>(result.to_ulong()) | computed_flag,
+            std::memory_order_release);
+
+        return result;
+    }
+
+    bool implements_interface(TypeDef const& type, well_known_interface interface_type)
+    {
+        return get_implemented_interfaces(type).test(
+            static_cast<size_t>(interface_type));
+    }
+
     bool implements_ibuffer(TypeDef const& type)
     {
-        return implements_interface(type, "Windows.Storage.Streams", "IBuffer");
+        return implements_interface(type, well_known_interface::IBuffer);
     }
 
     bool implements_imemorybufferreference(TypeDef const& type)
     {
-        return implements_interface(
-            type, "Windows.Foundation", "IMemoryBufferReference");
+        return implements_interface(type, well_known_interface::IMemoryBufferReference);
     }
 
     bool implements_istringable(TypeDef const& type)
     {
-        return implements_interface(type, "Windows.Foundation", "IStringable");
+        return implements_interface(type, well_known_interface::IStringable);
     }
 
     bool implements_iclosable(TypeDef const& type)
     {
-        return implements_interface(type, "Windows.Foundation", "IClosable");
+        return implements_interface(type, well_known_interface::IClosable);
     }
 
     bool implements_iasync(TypeDef const& type)
     {
-        return implements_interface(
-            type,
-            {std::make_tuple("Windows.Foundation", "IAsyncAction"),
-             std::make_tuple("Windows.Foundation", "IAsyncActionWithProgress`1"),
-             std::make_tuple("Windows.Foundation", "IAsyncOperation`1"),
-             std::make_tuple("Windows.Foundation", "IAsyncOperationWithProgress`2")});
+        auto interfaces = get_implemented_interfaces(type);
+
+        return interfaces.test(
+                   static_cast<size_t>(well_known_interface::IAsyncAction))
+               || interfaces.test(static_cast<size_t>(
+                   well_known_interface::IAsyncActionWithProgress))
+               || interfaces.test(
+                   static_cast<size_t>(well_known_interface::IAsyncOperation))
+               || interfaces.test(static_cast<size_t>(
+                   well_known_interface::IAsyncOperationWithProgress));
     }
 
     bool implements_iiterable(TypeDef const& type)
     {
-        return implements_interface(
-            type, "Windows.Foundation.Collections", "IIterable`1");
+        return implements_interface(type, well_known_interface::IIterable);
     }
 
     bool implements_iiterator(TypeDef const& type)
     {
-        return implements_interface(
-            type, "Windows.Foundation.Collections", "IIterator`1");
+        return implements_interface(type, well_known_interface::IIterator);
     }
 
     bool implements_ivector(TypeDef const& type)
     {
-        return implements_interface(
-            type, "Windows.Foundation.Collections", "IVector`1");
+        return implements_interface(type, well_known_interface::IVector);
     }
 
     bool implements_ivectorview(TypeDef const& type)
     {
-        return implements_interface(
-            type, "Windows.Foundation.Collections", "IVectorView`1");
+        return implements_interface(type, well_known_interface::IVectorView);
     }
 
     bool implements_imap(TypeDef const& type)
     {
-        return implements_interface(type, "Windows.Foundation.Collections", "IMap`2");
+        return implements_interface(type, well_known_interface::IMap);
     }
 
     bool implements_imapview(TypeDef const& type)
     {
-        return implements_interface(
-            type, "Windows.Foundation.Collections", "IMapView`2");
+        return implements_interface(type, well_known_interface::IMapView);
     }
 
     bool implements_sequence(TypeDef const& type)
@@ -714,6 +866,106 @@ namespace pywinrt
         return out;
     }
 
+    /**
+     * The signature of a method and the classification of its parameters,
+     * decoded from the metadata once and shared by all writers. See
+     * get_method_info().
+     */
+    struct method_info
+    {
+        explicit method_info(MethodDef const& method) : signature(method)
+        {
+            for (auto&& param : signature.params())
+            {
+                param_categories.push_back(get_param_category(param));
+
+                if (is_in_param(param))
+                {
+                    in_param_count++;
+                }
+
+                if (is_py_in_param(param))
+                {
+                    py_in_params.push_back(param);
+                }
+
+                if (is_py_out_param(param))
+                {
+                    py_out_params.push_back(param);
+                }
+            }
+
+            if (signature.return_signature())
+            {
+                return_category = get_param_category(signature.return_signature());
+            }
+
+            for (auto&& attribute : method.CustomAttribute())
+            {
+                if (attribute.TypeNamespaceAndName().second
+                    == "DefaultOverloadAttribute")
+                {
+                    is_default_overload = true;
+                }
+            }
+        }
+
+        // params point into the signature, so this can't be copied or moved
+        method_info(method_info const&) = delete;
+        method_info& operator=(method_info const&) = delete;
+
+        method_signature signature;
+
+        // the category of each of signature.params()
+        std::vector<param_category> param_categories;
+        std::optional<param_category> return_category;
+
+        // the same as count_in_param(), filter_py_in_params() and
+        // filter_py_out_params() of signature.params()
+        int in_param_count{};
+        std::vector<method_signature::param_t> py_in_params;
+        std::vector<method_signature::param_t> py_out_params;
+
+        bool is_default_overload{};
+    };
+
+    /**
+     * Gets the method_info of @p method, which is built on first use and kept
+     * in a per-database table indexed by MethodDef row. This may be called
+     * concurrently.
+     */
+    method_info const& get_method_info(MethodDef const& method)
+    {
+        struct slot
+        {
+            std::atomic<method_info const*> info{};
+
+            ~slot()
+            {
+                delete info.load();
+            }
+        };
+
+        auto const& db = method.get_database();
+        auto table = get_database_table<method_info, slot>(db, db.MethodDef.size());
+        auto& entry = table[method.index()];
+        auto info = entry.info.load(std::memory_order_acquire);
+
+        if (!info)
+        {
+            auto new_info = std::make_unique<method_info const>(method);
+
+            // if another thread got there first, use its copy instead
+            if (entry.info.compare_exchange_strong(
+                    info, new_info.get(), std::memory_order_acq_rel))
+            {
+                info = new_info.release();
+            }
+        }
+
+        return *info;
+    }
+
     enum class argument_convention
     {
         no_args,
@@ -730,7 +982,7 @@ namespace pywinrt
         }
         else if (method.SpecialName())
         {
-            method_signature signature{method};
+            auto const& signature = get_method_info(method).signature;
 
             if (signature.has_params())
             {
@@ -832,6 +1084,1184 @@ namespace pywinrt
         return set.find(value) != set.end();
     }
 
+    /**
+     * The members of a type and of all of the interfaces it requires, in the
+     * order that the writers visit them.
+     *
+     * Each required type records the generic arguments of every InterfaceImpl
+     * on the path from the indexed type down to it, so that the writer can
+     * recreate the generic parameter context that walking the required types
+     * would have set up. Indexes don't depend on any writer and are shared
+     * between threads through get_member_index().
+     */
+    struct type_member_index
+    {
+        struct required_type
+        {
+            TypeDef type;
+            std::vector<std::vector<type_semantics>> generic_args;
+        };
+
+        template<typename T>
+        struct member
+        {
+            // index into required_types of the type that declares the member
+            size_t required_index;
+            T value;
+        };
+
+        struct method_overload
+        {
+            size_t required_index;
+            MethodDef method;
+            int py_arity;
+        };
+
+        struct method_group
+        {
+            std::string_view name;
+
+            // one method per required type and number of Python arguments;
+            // when several methods share both, the [DefaultOverload] one
+            std::vector<method_overload> overloads;
+        };
+
+        std::vector<required_type> required_types;
+
+        // sorted by name, excluding special name methods (.ctor, get_/put_ and
+        // add_/remove_)
+        std::vector<method_group> methods;
+
+        std::vector<member<Property>> properties;
+        std::vector<member<Event>> events;
+
+        method_group const* find_method_group(std::string_view const& name) const
+        {
+            auto it = std::lower_bound(
+                methods.begin(),
+                methods.end(),
+                name,
+                [](method_group const& group, std::string_view const& value)
+                {
+                    return group.name < value;
+                });
+
+            return it != methods.end() && it->name == name ? &*it : nullptr;
+        }
+    };
+
+    type_member_index build_member_index(TypeDef const& type)
+    {
+        type_member_index index;
+        std::set<TypeDef> visited;
+        std::vector<std::vector<type_semantics>> path;
+
+        auto visit = [&](type_semantics const& semantics, auto const& self) -> void
+        {
+            auto required_type = get_typedef(semantics);
+            auto generic_args = std::visit(
+                impl::overloaded{
+                    [](type_definition) -> std::vector<type_semantics>
+                    {
+                        return {};
+                    },
+                    [](generic_type_instance type_instance)
+                    {
+                        return type_instance.generic_args;
+                    },
+                    [](auto) -> std::vector<type_semantics>
+                    {
+                        throw_invalid("type doesn't contain typedef");
+                    }},
+                semantics);
+
+            auto pushed = !generic_args.empty();
+
+            if (pushed)
+            {
+                path.push_back(std::move(generic_args));
+            }
+
+            if (visited.insert(required_type).second)
+            {
+                index.required_types.push_back({required_type, path});
+            }
+
+            if (get_category(required_type) == category::interface_type)
+            {
+                for (auto&& ii : required_type.InterfaceImpl())
+                {
+                    self(get_type_semantics(ii.Interface()), self);
+                }
+            }
+
+            if (pushed)
+            {
+                path.pop_back();
+            }
+        };
+
+        visit(type, visit);
+
+        std::set<std::string_view> method_names;
+
+        for (size_t i{}; i < index.required_types.size(); i++)
+        {
+            auto const& required_type = index.required_types[i].type;
+
+            for (auto&& method : required_type.MethodList())
+            {
+                if (!method.SpecialName())
+                {
+                    method_names.insert(method.Name());
+                }
+            }
+
+            for (auto&& prop : required_type.PropertyList())
+            {
+                index.properties.push_back({i, prop});
+            }
+
+            for (auto&& evt : required_type.EventList())
+            {
+                index.events.push_back({i, evt});
+            }
+        }
+
+        // REVISIT: this doesn't handle the case if an interface has an overload
+        // with the same number of parameters as a required interface
+        for (auto&& method_name : method_names)
+        {
+            auto& group = index.methods.emplace_back();
+            group.name = method_name;
+
+            for (size_t i{}; i < index.required_types.size(); i++)
+            {
+                // map of overloads by number of parameters
+                std::map<int, std::vector<MethodDef>> overloads;
+
+                for (auto&& method : index.required_types[i].type.MethodList())
+                {
+                    if (method.Name() != method_name)
+                    {
+                        continue;
+                    }
+
+                    auto arg_count = static_cast<int>(
+                        get_method_info(method).py_in_params.size());
+                    overloads[arg_count].push_back(method);
+                }
+
+                for (auto&& [arg_count, methods] : overloads)
+                {
+                    // if there are multiple overloads with the same number of
+                    // arguments, we need to use the default overload
+                    // https://devblogs.microsoft.com/oldnewthing/20210528-00/?p=105259
+                    auto default_overload = std::find_if(
+                        methods.begin(),
+                        methods.end(),
+                        [](auto const& m)
+                        {
+                            return get_method_info(m).is_default_overload;
+                        });
+
+                    // if there was no default, just use the first (and
+                    // hopefully only) overload
+                    group.overloads.push_back(
+                        {i,
+                         default_overload == methods.end() ? methods.front()
+                                                           : *default_overload,
+                         arg_count});
+                }
+            }
+        }
+
+        return index;
+    }
+
+    /**
+     * Gets the member index of a type, building it the first time it is
+     * requested. This may be called concurrently.
+     */
+    type_member_index const& get_member_index(TypeDef const& type)
+    {
+        static std::shared_mutex lock;
+        static std::map<TypeDef, std::unique_ptr<type_member_index const>> indexes;
+
+        {
+            std::shared_lock read_lock{lock};
+            auto it = indexes.find(type);
+
+            if (it != indexes.end())
+            {
+                return *it->second;
+            }
+        }
+
+        // built outside of the lock; if another thread wins the race to
+        // build the same index, its copy is kept and this one is discarded
+        auto index
+            = std::make_unique<type_member_index const>(build_member_index(type));
+
+        std::unique_lock write_lock{lock};
+        return *indexes.try_emplace(type, std::move(index)).first->second;
+    }
+
+    using namespace_id = uint32_t;
+
+    /**
+     * Gives each namespace in the metadata a small integer ID so that sets of
+     * namespaces can be stored as bitsets. IDs are assigned in alphabetical
+     * order, so iterating a namespace_set gives the same order as a
+     * std::set<std::string>.
+     */
+    struct namespace_ids
+    {
+        /**
+         * Assigns the IDs. This must be called once after the cache is loaded
+         * and before any namespace_set is used.
+         */
+        static void assign(cache const& c)
+        {
+            m_names.clear();
+            m_ids.clear();
+
+            for (auto&& [ns, members] : c.namespaces())
+            {
+                m_ids.emplace(ns, static_cast<namespace_id>(m_names.size()));
+                m_names.push_back(ns);
+            }
+        }
+
+        static namespace_id find(std::string_view const& ns)
+        {
+            auto it = m_ids.find(ns);
+
+            if (it == m_ids.end())
+            {
+                throw_invalid("Namespace '", ns, "' not found");
+            }
+
+            return it->second;
+        }
+
+        static std::string_view name(namespace_id id)
+        {
+            return m_names[id];
+        }
+
+      private:
+        static inline std::vector<std::string_view> m_names;
+        static inline std::unordered_map<std::string_view, namespace_id> m_ids;
+    };
+
+    /**
+     * A set of namespaces, stored as one bit per namespace_id. Iterating the
+     * set gives the namespace names in alphabetical order.
+     */
+    struct namespace_set
+    {
+        struct iterator
+        {
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::string_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = std::string_view;
+
+            std::string_view operator*() const
+            {
+                return namespace_ids::name(m_id);
+            }
+
+            iterator& operator++()
+            {
+                m_id = m_set->next(m_id + 1);
+                return *this;
+            }
+
+            iterator operator++(int)
+            {
+                auto result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator==(iterator const& other) const noexcept
+            {
+                return m_id == other.m_id;
+            }
+
+            bool operator!=(iterator const& other) const noexcept
+            {
+                return m_id != other.m_id;
+            }
+
+          private:
+            friend namespace_set;
+
+            iterator(namespace_set const* set, namespace_id id) : m_set(set), m_id(id)
+            {
+            }
+
+            namespace_set const* m_set;
+            namespace_id m_id;
+        };
+
+        bool insert(namespace_id id)
+        {
+            auto word = id / bits_per_word;
+
+            if (word >= m_words.size())
+            {
+                m_words.resize(word + 1);
+            }
+
+            auto mask = uint32_t{1} << (id % bits_per_word);
+            auto inserted = (m_words[word] & mask) == 0;
+            m_words[word] |= mask;
+            return inserted;
+        }
+
+        bool insert(std::string_view const& ns)
+        {
+            return insert(namespace_ids::find(ns));
+        }
+
+        bool contains(namespace_id id) const noexcept
+        {
+            auto word = id / bits_per_word;
+            return word < m_words.size()
+                   && (m_words[word] & (uint32_t{1} << (id % bits_per_word))) != 0;
+        }
+
+        bool contains(std::string_view const& ns) const
+        {
+            return contains(namespace_ids::find(ns));
+        }
+
+        /**
+         * Checks if every namespace in @p other is also in this set.
+         */
+        bool includes(namespace_set const& other) const noexcept
+        {
+            for (size_t i{}; i < other.m_words.size(); i++)
+            {
+                auto word = i < m_words.size() ? m_words[i] : 0;
+
+                if ((other.m_words[i] & ~word) != 0)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        namespace_set& operator|=(namespace_set const& other)
+        {
+            if (other.m_words.size() > m_words.size())
+            {
+                m_words.resize(other.m_words.size());
+            }
+
+            for (size_t i{}; i < other.m_words.size(); i++)
+            {
+                m_words[i] |= other.m_words[i];
+            }
+
+            return *this;
+        }
+
+        bool empty() const noexcept
+        {
+            return begin() == end();
+        }
+
+        size_t size() const noexcept
+        {
+            size_t result{};
+
+            for (auto word : m_words)
+            {
+                result += std::bitset<bits_per_word>(word).count();
+            }
+
+            return result;
+        }
+
+        iterator begin() const noexcept
+        {
+            return {this, next(0)};
+        }
+
+        iterator end() const noexcept
+        {
+            return {this, end_id()};
+        }
+
+      private:
+        static constexpr namespace_id bits_per_word{32};
+
+        namespace_id end_id() const noexcept
+        {
+            return static_cast<namespace_id>(m_words.size()) * bits_per_word;
+        }
+
+        /**
+         * Gets the first ID in the set that is >= @p id or end_id().
+         */
+        namespace_id next(namespace_id id) const noexcept
+        {
+            for (auto word = id / bits_per_word; word < m_words.size(); word++)
+            {
+                auto bits = m_words[word];
+
+                if (word == id / bits_per_word)
+                {
+                    bits &= ~uint32_t{0} << (id % bits_per_word);
+                }
+
+                if (bits != 0)
+                {
+                    return word * bits_per_word + text::count_trailing_zeros(bits);
+                }
+            }
+
+            return end_id();
+        }
+
+        std::vector<uint32_t> m_words;
+    };
+
+    /**
+     * A set of types as (namespace, name) pairs, which sorts the types of each
+     * namespace together.
+     */
+    using type_name_set = std::set<std::pair<std::string_view, std::string_view>>;
+
+    /**
+     * Finds the types that projecting the @p roots depends on: the roots, the
+     * base classes and required interfaces of each type, and every type in
+     * their method signatures and fields, transitively.
+     *
+     * @param [in]  c           The cache of the input metadata.
+     * @param [in]  roots       The full names of the root types, or namespaces
+     *                          that stand for all of their types.
+     * @param [in]  type_filter The types that may be projected. Other types are
+     *                          neither included nor followed.
+     * @returns The reachable types.
+     */
+    type_name_set get_reachable_types(
+        cache const& c, std::set<std::string> const& roots, filter const& type_filter)
+    {
+        type_name_set result;
+        std::vector<TypeDef> pending;
+
+        auto add = [&](TypeDef const& type)
+        {
+            if (type_filter.includes(type)
+                && result.emplace(type.TypeNamespace(), type.TypeName()).second)
+            {
+                pending.push_back(type);
+            }
+        };
+
+        auto add_semantics
+            = [&](type_semantics const& semantics, auto const& self) -> void
+        {
+            call(
+                semantics,
+                [&](type_definition const& type)
+                {
+                    add(type);
+                },
+                [&](generic_type_instance const& type)
+                {
+                    add(type.generic_type);
+
+                    for (auto&& arg : type.generic_args)
+                    {
+                        self(arg, self);
+                    }
+                },
+                [](auto&&)
+                {
+                });
+        };
+
+        auto add_type = [&](coded_index<TypeDefOrRef> const& type)
+        {
+            // e.g. System.Object, System.Enum and System.Guid
+            if (type.type() == TypeDefOrRef::TypeRef
+                && type.TypeRef().TypeNamespace() == "System")
+            {
+                return;
+            }
+
+            add_semantics(get_type_semantics(type), add_semantics);
+        };
+
+        auto add_signature = [&](TypeSig const& signature)
+        {
+            add_semantics(get_type_semantics(signature), add_semantics);
+        };
+
+        for (auto&& root : roots)
+        {
+            auto ns = c.namespaces().find(root);
+
+            if (ns != c.namespaces().end())
+            {
+                for (auto&& [name, type] : ns->second.types)
+                {
+                    add(type);
+                }
+
+                continue;
+            }
+
+            auto pos = root.rfind('.');
+
+            if (pos != std::string::npos)
+            {
+                ns = c.namespaces().find(std::string_view{root}.substr(0, pos));
+            }
+
+            if (pos == std::string::npos || ns == c.namespaces().end())
+            {
+                throw_invalid("Root '", root, "' is not a namespace or type");
+            }
+
+            auto type = ns->second.types.find(std::string_view{root}.substr(pos + 1));
+
+            if (type == ns->second.types.end())
+            {
+                throw_invalid("Root '", root, "' is not a namespace or type");
+            }
+
+            add(type->second);
+        }
+
+        while (!pending.empty())
+        {
+            auto type = pending.back();
+            pending.pop_back();
+
+            if (type.Extends())
+            {
+                add_type(type.Extends());
+            }
+
+            for (auto&& ii : type.InterfaceImpl())
+            {
+                add_type(ii.Interface());
+            }
+
+            for (auto&& method : type.MethodList())
+            {
+                auto signature = method.Signature();
+
+                if (signature.ReturnType())
+                {
+                    add_signature(signature.ReturnType().Type());
+                }
+
+                for (auto&& param : signature.Params())
+                {
+                    add_signature(param.Type());
+                }
+            }
+
+            for (auto&& field : type.FieldList())
+            {
+                add_signature(field.Signature().Type());
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * Gets a copy of @p members with only the types included by @p type_filter
+     * and, if given, @p reachable_types.
+     *
+     * This is done once per namespace so that the writers for each of the
+     * generated files can share the result instead of testing every type
+     * against the filter again.
+     */
+    cache::namespace_members filter_namespace_members(
+        cache::namespace_members const& members,
+        filter const& type_filter,
+        type_name_set const* reachable_types = nullptr)
+    {
+        cache::namespace_members result;
+
+        auto includes = [&](TypeDef const& type)
+        {
+            return type_filter.includes(type)
+                   && (!reachable_types
+                       || contains(
+                           *reachable_types,
+                           std::pair{type.TypeNamespace(), type.TypeName()}));
+        };
+
+        auto copy_included
+            = [&](std::vector<TypeDef> const& source, std::vector<TypeDef>& destination)
+        {
+            std::copy_if(
+                source.begin(),
+                source.end(),
+                std::back_inserter(destination),
+                includes);
+        };
+
+        for (auto&& [name, type] : members.types)
+        {
+            if (includes(type))
+            {
+                result.types.emplace(name, type);
+            }
+        }
+
+        copy_included(members.interfaces, result.interfaces);
+        copy_included(members.classes, result.classes);
+        copy_included(members.enums, result.enums);
+        copy_included(members.structs, result.structs);
+        copy_included(members.delegates, result.delegates);
+        copy_included(members.attributes, result.attributes);
+        copy_included(members.contracts, result.contracts);
+
+        return result;
+    }
+
+    /**
+     * The namespaces referenced by the code generated for a namespace.
+     */
+    struct namespace_dependencies
+    {
+        // every referenced namespace, not including the namespace itself
+        namespace_set namespaces;
+
+        // the namespaces whose delegates or parameterized types are used, whose
+        // definitions are only in py.<ns>.h rather than py.<ns>.fwd.h, and the
+        // namespaces of required interfaces, whose methods are only defined in
+        // the <winrt/<ns>.h> that py.<ns>.h includes
+        namespace_set full_headers;
+    };
+
+    /**
+     * Collects the namespaces of the types referenced by the code generated for
+     * the types in @p members.
+     *
+     * This follows the same rules as the writer uses to fill
+     * writer::needed_namespaces while writing the .cpp file for a namespace, but
+     * only walks the metadata, so the other files for the namespace don't have
+     * to wait for the .cpp file to be written. Members are enumerated through
+     * the same type_member_index as the writers, so overloads that aren't
+     * projected are skipped.
+     *
+     * The result is a superset of what the .cpp writer records, not an exact
+     * copy. The writers register a namespace wherever a type happens to be
+     * written (including the generic arguments that are written to set up the
+     * context of a required interface), and mirroring every such site here
+     * would be as fragile as it is large. A namespace that is only found here
+     * adds an include to py.<ns>.h and a guarded import to the __init__ files,
+     * which costs a little time but doesn't change behavior. Missing one would
+     * break the build, so debug builds check that this covers the .cpp
+     * writer.
+     *
+     * The full headers also cover the signatures of the delegates and
+     * parameterized interfaces, since their wrappers in the .h file are
+     * compiled by every namespace that includes it.
+     *
+     * @param [in]  ns      The namespace being projected.
+     * @param [in]  members The members of the namespace, from
+     *                      filter_namespace_members().
+     * @returns The sets of namespaces, not including @p ns.
+     */
+    namespace_dependencies get_needed_namespaces(
+        std::string_view const& ns, cache::namespace_members const& members)
+    {
+        namespace_dependencies result;
+
+        // set while walking the types that are only written to the .h file
+        bool header_only{};
+
+        auto add_namespace = [&](std::string_view const& type_ns, bool full_header)
+        {
+            if (type_ns == ns || type_ns == "System")
+            {
+                return;
+            }
+
+            if (!header_only)
+            {
+                result.namespaces.insert(type_ns);
+            }
+
+            if (full_header)
+            {
+                result.full_headers.insert(type_ns);
+            }
+        };
+
+        auto add_type_def = [&](TypeDef const& type)
+        {
+            add_namespace(
+                type.TypeNamespace(),
+                get_category(type) == category::delegate_type);
+        };
+
+        auto add_semantics
+            = [&](type_semantics const& semantics, auto const& self) -> void
+        {
+            call(
+                semantics,
+                [&](type_definition const& type)
+                {
+                    add_type_def(type);
+                },
+                [&](generic_type_instance const& type)
+                {
+                    add_namespace(type.generic_type.TypeNamespace(), true);
+
+                    for (auto&& arg : type.generic_args)
+                    {
+                        self(arg, self);
+                    }
+                },
+                [](auto&&)
+                {
+                });
+        };
+
+        auto add_signature = [&](TypeSig const& signature, auto const& self) -> void
+        {
+            // the generic types are always delegates or interfaces
+            auto add_type = [&](coded_index<TypeDefOrRef> const& type, bool generic)
+            {
+                switch (type.type())
+                {
+                case TypeDefOrRef::TypeDef:
+                    if (generic)
+                    {
+                        add_namespace(type.TypeDef().TypeNamespace(), true);
+                    }
+                    else
+                    {
+                        add_type_def(type.TypeDef());
+                    }
+                    break;
+
+                case TypeDefOrRef::TypeRef:
+                {
+                    auto type_ref = type.TypeRef();
+                    auto type_ns = type_ref.TypeNamespace();
+
+                    if (generic)
+                    {
+                        add_namespace(type_ns, true);
+                    }
+                    else if (type_ns != ns && type_ns != "System")
+                    {
+                        // only types in other namespaces have to be resolved
+                        // to find the delegates
+                        add_type_def(find_required(type_ref));
+                    }
+                }
+                break;
+
+                case TypeDefOrRef::TypeSpec:
+                {
+                    auto generic_inst = type.TypeSpec().Signature().GenericTypeInst();
+                    add_semantics(get_type_semantics(generic_inst), add_semantics);
+                }
+                break;
+                }
+            };
+
+            call(
+                signature.Type(),
+                [](ElementType)
+                {
+                },
+                [](GenericTypeIndex)
+                {
+                },
+                [](GenericMethodTypeIndex)
+                {
+                    throw_invalid("Generic methods not supported");
+                },
+                [&](coded_index<TypeDefOrRef> const& type)
+                {
+                    add_type(type, false);
+                },
+                [&](GenericTypeInstSig const& type)
+                {
+                    add_type(type.GenericType(), true);
+
+                    for (auto&& arg : type.GenericArgs())
+                    {
+                        self(arg, self);
+                    }
+                });
+        };
+
+        auto add_method = [&](MethodDef const& method)
+        {
+            auto signature = method.Signature();
+
+            if (signature.ReturnType())
+            {
+                add_signature(signature.ReturnType().Type(), add_signature);
+            }
+
+            for (auto&& param : signature.Params())
+            {
+                add_signature(param.Type(), add_signature);
+            }
+        };
+
+        // Classes and non-parameterized interfaces reference the signatures of
+        // the members that the .cpp writers enumerate. Those come from the same
+        // type_member_index, so overloads that aren't projected are skipped.
+        auto add_members = [&](TypeDef const& type)
+        {
+            auto const& index = get_member_index(type);
+
+            for (auto&& group : index.methods)
+            {
+                for (auto&& overload : group.overloads)
+                {
+                    add_method(overload.method);
+                }
+            }
+
+            for (auto&& prop : index.properties)
+            {
+                auto [get_method, put_method] = get_property_methods(prop.value);
+                add_method(get_method);
+
+                if (put_method)
+                {
+                    add_method(put_method);
+                }
+            }
+
+            for (auto&& evt : index.events)
+            {
+                auto [event_add, event_remove] = get_event_methods(evt.value);
+                add_method(event_add);
+                add_method(event_remove);
+            }
+
+            if (get_category(type) == category::class_type && !is_static_class(type))
+            {
+                for (auto&& ctor : get_constructors(type))
+                {
+                    add_method(ctor);
+                }
+            }
+        };
+
+        // classes and interfaces call the methods of all required interfaces and
+        // reference their generic arguments, and the parameterized interface
+        // wrappers in the .h file reference all method signatures
+        auto add_object = [&](TypeDef const& type)
+        {
+            if (is_exclusive_to(type))
+            {
+                return;
+            }
+
+            if (!is_ptype(type) && !header_only)
+            {
+                add_members(type);
+            }
+
+            auto add_required
+                = [&](type_semantics const& semantics, auto const& self) -> void
+            {
+                auto required_type = get_typedef(semantics);
+                add_namespace(required_type.TypeNamespace(), true);
+
+                if (auto gti = std::get_if<generic_type_instance>(&semantics))
+                {
+                    for (auto&& arg : gti->generic_args)
+                    {
+                        add_semantics(arg, add_semantics);
+                    }
+                }
+
+                if (header_only)
+                {
+                    for (auto&& method : required_type.MethodList())
+                    {
+                        add_method(method);
+                    }
+                }
+
+                if (get_category(required_type) == category::interface_type)
+                {
+                    for (auto&& ii : required_type.InterfaceImpl())
+                    {
+                        self(get_type_semantics(ii.Interface()), self);
+                    }
+                }
+            };
+
+            add_required(type, add_required);
+        };
+
+        for (auto&& type : members.classes)
+        {
+            add_object(type);
+        }
+
+        for (auto&& type : members.interfaces)
+        {
+            add_object(type);
+        }
+
+        for (auto&& type : members.structs)
+        {
+            if (is_customized_struct(type))
+            {
+                continue;
+            }
+
+            for (auto&& field : type.FieldList())
+            {
+                add_signature(field.Signature().Type(), add_signature);
+            }
+        }
+
+        header_only = true;
+
+        for (auto&& type : members.interfaces)
+        {
+            if (is_ptype(type))
+            {
+                add_object(type);
+            }
+        }
+
+        for (auto&& type : members.delegates)
+        {
+            add_method(get_delegate_invoke(type));
+        }
+
+        return result;
+    }
+
+    /**
+     * Relative weights used by estimate_namespace_cost().
+     *
+     * These are rough starting points. The -verbose report prints the predicted
+     * and actual time for each namespace so they can be tuned.
+     */
+    struct namespace_cost_weights
+    {
+        static constexpr uint64_t type = 8;
+        static constexpr uint64_t method = 4;
+        static constexpr uint64_t property = 3;
+        static constexpr uint64_t event = 3;
+        static constexpr uint64_t field = 2;
+        // parameterized interfaces are also written as templates in the .h file
+        static constexpr uint64_t generic_interface_factor = 2;
+        // parsing the projection headers of a namespace needed by a group of
+        // namespaces, see group_namespaces()
+        static constexpr uint64_t included_namespace = 400;
+    };
+
+    /**
+     * Estimates the relative amount of work needed to project a namespace.
+     *
+     * This is used to start the most expensive namespaces first so that a large
+     * namespace doesn't end up being the only thing left running at the end.
+     *
+     * @param [in]  members The members of the namespace, from
+     *                      filter_namespace_members().
+     * @returns The estimated cost in arbitrary units.
+     */
+    uint64_t estimate_namespace_cost(cache::namespace_members const& members)
+    {
+        using weights = namespace_cost_weights;
+
+        uint64_t cost{};
+
+        auto add_object = [&](TypeDef const& type)
+        {
+            if (is_exclusive_to(type))
+            {
+                return;
+            }
+
+            // the writers expand the members of every interface that the type
+            // requires, which the member index has already collected
+            auto const& index = get_member_index(type);
+            uint64_t methods{};
+
+            for (auto&& group : index.methods)
+            {
+                methods += group.overloads.size();
+            }
+
+            if (get_category(type) == category::class_type)
+            {
+                methods += get_constructors(type).size();
+            }
+
+            uint64_t type_cost = weights::type + weights::method * methods
+                                 + weights::property * index.properties.size()
+                                 + weights::event * index.events.size();
+
+            if (is_ptype(type))
+            {
+                type_cost *= weights::generic_interface_factor;
+            }
+
+            cost += type_cost;
+        };
+
+        auto add_fields = [&](TypeDef const& type)
+        {
+            cost += weights::type + weights::field * distance(type.FieldList());
+        };
+
+        for (auto&& type : members.classes)
+        {
+            add_object(type);
+        }
+
+        for (auto&& type : members.interfaces)
+        {
+            add_object(type);
+        }
+
+        for (auto&& type : members.delegates)
+        {
+            uint64_t type_cost
+                = weights::type + weights::method * distance(type.MethodList());
+
+            if (is_ptype(type))
+            {
+                type_cost *= weights::generic_interface_factor;
+            }
+
+            cost += type_cost;
+        }
+
+        for (auto&& type : members.structs)
+        {
+            add_fields(type);
+        }
+
+        for (auto&& type : members.enums)
+        {
+            add_fields(type);
+        }
+
+        return cost;
+    }
+
+    struct namespace_group
+    {
+        std::vector<std::string_view> namespaces;
+        uint64_t cost{};
+
+        // the namespaces in the group and the namespaces that they include
+        namespace_set includes;
+    };
+
+    /**
+     * Splits the namespaces into groups that are each compiled as one unity
+     * translation unit or with one precompiled header.
+     *
+     * The cost of a group is the estimated cost of its namespaces plus the cost
+     * of parsing the headers of every namespace that they include, which is
+     * only paid once per group. Namespaces are placed from the most expensive
+     * down, each in the group whose cost grows the least. This keeps the
+     * groups balanced and puts namespaces that include the same headers
+     * together.
+     *
+     * @param [in]  namespaces  Each namespace with its estimated cost, from
+     *                          estimate_namespace_cost(), and the namespaces
+     *                          it needs, from get_needed_namespaces().
+     * @param [in]  count       The maximum number of groups.
+     * @returns The non-empty groups with their namespaces in alphabetical
+     *          order.
+     */
+    std::vector<namespace_group> group_namespaces(
+        std::vector<std::tuple<std::string_view, uint64_t, namespace_set>> namespaces,
+        uint32_t count)
+    {
+        std::sort(
+            namespaces.begin(),
+            namespaces.end(),
+            [](auto const& lhs, auto const& rhs)
+            {
+                auto const& [lhs_ns, lhs_cost, lhs_needed] = lhs;
+                auto const& [rhs_ns, rhs_cost, rhs_needed] = rhs;
+                return lhs_cost != rhs_cost ? lhs_cost > rhs_cost : lhs_ns < rhs_ns;
+            });
+
+        std::vector<namespace_group> groups(std::max(count, 1u));
+
+        for (auto&& [ns, cost, needed] : namespaces)
+        {
+            needed.insert(ns);
+
+            auto get_cost_after_adding = [&, &needed = needed, cost = cost](
+                                             namespace_group const& group)
+            {
+                auto includes = group.includes;
+                includes |= needed;
+                return group.cost + cost
+                       + namespace_cost_weights::included_namespace
+                             * (includes.size() - group.includes.size());
+            };
+
+            auto& group = *std::min_element(
+                groups.begin(),
+                groups.end(),
+                [&](namespace_group const& lhs, namespace_group const& rhs)
+                {
+                    return get_cost_after_adding(lhs) < get_cost_after_adding(rhs);
+                });
+
+            group.cost = get_cost_after_adding(group);
+            group.includes |= needed;
+            group.namespaces.push_back(ns);
+        }
+
+        groups.erase(
+            std::remove_if(
+                groups.begin(),
+                groups.end(),
+                [](namespace_group const& group)
+                {
+                    return group.namespaces.empty();
+                }),
+            groups.end());
+
+        for (auto&& group : groups)
+        {
+            std::sort(group.namespaces.begin(), group.namespaces.end());
+        }
+
+        std::sort(
+            groups.begin(),
+            groups.end(),
+            [](namespace_group const& lhs, namespace_group const& rhs)
+            {
+                return lhs.namespaces.front() < rhs.namespaces.front();
+            });
+
+        return groups;
+    }
+
     /**
      * Checks if a WinRT type has any features that require a Python metaclass.
      */
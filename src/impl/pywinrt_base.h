@@ -1,16 +1,27 @@
 #pragma once
 
+#if defined(_WIN32)
 #include <windows.h>
 #include <shlwapi.h>
 #include <xmllite.h>
+#endif
 #include <stdexcept>
 #include <assert.h>
 #include <array>
+#include <atomic>
 #include <bitset>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
 #include <future>
+#include <iterator>
 #include <list>
 #include <map>
+#include <mutex>
 #include <optional>
 #include <regex>
 #include <string>
@@ -18,8 +29,17 @@
 #include <variant>
 #include <vector>
 #include <set>
+#include <shared_mutex>
 #include <filesystem>
 
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
 #if defined(_DEBUG)
 #define XLANG_DEBUG
 #endif
@@ -6,6 +6,8 @@
 #include "type_writers.h"
 #include "code_writers.h"
 #include "file_writers.h"
+#include "manifest.h"
+#include "metadata_index.h"
 
 namespace pywinrt
 {
@@ -32,8 +34,46 @@ namespace pywinrt
          cmd::option::no_max,
          "<prefix>",
          "One or more prefixes to exclude from projection"},
+        {"roots",
+         0,
+         cmd::option::no_max,
+         "<spec>",
+         "One or more types or namespaces to project along with only the types "
+         "they depend on"},
         {"verbose", 0, 0, {}, "Show detailed progress information"},
         {"module", 0, 1, "<name>", "Name of generated projection. Defaults to winrt."},
+        {"jobs",
+         0,
+         1,
+         "<count>",
+         "Maximum number of parallel jobs. Defaults to the number of processors."},
+        {"force",
+         0,
+         0,
+         {},
+         "Regenerate all namespaces, even if their inputs have not changed"},
+        {"verify",
+         0,
+         0,
+         {},
+         "Compare output with existing files even when their hashes match"},
+        {"index",
+         0,
+         0,
+         {},
+         "Reuse the analysis of unchanged metadata from the previous run"},
+        {"trace", 0, 1, "<path>", "Write a Chrome trace of the run to <path>"},
+        {"unity",
+         0,
+         1,
+         "<count>",
+         "Group the namespace sources into unity build files. Defaults to 16."},
+        {"pch",
+         0,
+         1,
+         "<count>",
+         "Compile each group of namespaces with its own precompiled header. Defaults "
+         "to 16, or the unity build files with -unity."},
         {"help", 0, cmd::option::no_max, {}, "Show detailed help"},
     };
 
@@ -54,7 +94,7 @@ namespace pywinrt
             printColumns(w, w.write_temp("-% %", opt.name, opt.arg), opt.desc);
         };
 
-        auto format = R"(
+        auto format = PYWINRT_FORMAT(R"(
 Py/WinRT v%
 Copyright (c) Microsoft Corporation. All rights reserved.
 
@@ -70,10 +110,32 @@ Where <spec> is one or more of:
   local               Local ^%WinDir^%\System32\WinMetadata folder
   sdk[+]              Current version of Windows SDK [with extensions]
   10.0.12345.0[+]     Specific version of Windows SDK [with extensions]
-)";
+)");
         w.write(format, PYWINRT_VERSION_STRING, bind_each(printOption, options));
     }
 
+    /**
+     * Parses the value of an option that takes a count of at least one.
+     */
+    uint32_t parse_count(std::string_view const& name, std::string const& value)
+    {
+        uint32_t result{};
+        auto end = value.data() + value.size();
+        auto [ptr, ec] = std::from_chars(value.data(), end, result);
+
+        if (value.empty() || ec != std::errc{} || ptr != end)
+        {
+            throw_invalid("Option '-", name, "' requires a number");
+        }
+
+        if (result == 0)
+        {
+            throw_invalid("Option '-", name, "' requires a number greater than 0");
+        }
+
+        return result;
+    }
+
     void process_args(int const argc, char** argv)
     {
         cmd::reader args{argc, argv, options};
@@ -85,6 +147,31 @@ Where <spec> is one or more of:
 
         settings.verbose = args.exists("verbose");
         settings.module = args.value("module", "winrt");
+
+        if (args.exists("jobs"))
+        {
+            settings.jobs = parse_count("jobs", args.value("jobs"));
+        }
+
+        if (args.exists("unity"))
+        {
+            settings.unity = parse_count("unity", args.value("unity", "16"));
+        }
+
+        if (args.exists("pch"))
+        {
+            settings.pch = parse_count("pch", args.value("pch", "16"));
+        }
+
+        settings.force = args.exists("force");
+        settings.verify = args.exists("verify");
+        settings.index = args.exists("index");
+
+        if (args.exists("trace"))
+        {
+            settings.trace = absolute(args.value("trace"));
+        }
+
         settings.input = args.files("input", database::is_database);
 
         for (auto&& include : args.values("include"))
@@ -97,6 +184,11 @@ Where <spec> is one or more of:
             settings.exclude.insert(exclude);
         }
 
+        for (auto&& root : args.values("roots"))
+        {
+            settings.roots.insert(root);
+        }
+
         settings.output_folder = absolute(args.value("output", "output"));
         create_directories(settings.output_folder);
     }
@@ -108,6 +200,38 @@ Where <spec> is one or more of:
         return files;
     }
 
+    /**
+     * Gets the path of the running generator, so that its contents can be part
+     * of the hashes that decide whether the output is up to date.
+     */
+    std::string get_generator_path()
+    {
+#if defined(_WIN32)
+        std::string path(MAX_PATH, '\0');
+
+        while (true)
+        {
+            auto size = GetModuleFileNameA(
+                nullptr, path.data(), static_cast<DWORD>(path.size()));
+
+            if (size == 0)
+            {
+                throw_invalid("Could not get the path of the generator");
+            }
+
+            if (size < path.size())
+            {
+                path.resize(size);
+                return path;
+            }
+
+            path.resize(path.size() * 2);
+        }
+#else
+        return std::filesystem::read_symlink("/proc/self/exe").string();
+#endif
+    }
+
     bool has_projected_types(cache::namespace_members const& members)
     {
         return !members.interfaces.empty() || !members.classes.empty()
@@ -115,6 +239,31 @@ Where <spec> is one or more of:
                || !members.delegates.empty();
     }
 
+    /**
+     * Gets the folder of the Python package for a namespace.
+     */
+    stdfs::path get_namespace_folder(
+        stdfs::path const& module_dir, std::string_view const& ns)
+    {
+        auto ns_dir = module_dir;
+
+        for (auto&& ns_segment : get_dotted_name_segments(ns))
+        {
+            std::string segment{ns_segment};
+            std::transform(
+                segment.begin(),
+                segment.end(),
+                segment.begin(),
+                [](char c)
+                {
+                    return static_cast<char>(::tolower(c));
+                });
+            ns_dir /= segment;
+        }
+
+        return ns_dir;
+    }
+
     int run(int const argc, char** argv)
     {
         int result{};
@@ -124,7 +273,74 @@ Where <spec> is one or more of:
         {
             auto start = get_start_time();
             process_args(argc, argv);
-            cache c{get_files_to_cache()};
+
+            std::map<std::string_view, hash_value> input_hashes;
+
+            trace_recorder trace;
+
+            if (!settings.trace.empty())
+            {
+                trace_recorder::current = &trace;
+            }
+
+            // declared before the task group so that it outlives any task that
+            // is still writing a file when an error ends the run
+            digest_store digests;
+            writer::digests_guard digests_scope{digests};
+
+            std::mutex timings_lock;
+            std::vector<std::pair<std::string, int64_t>> timings;
+            task_group group{settings.jobs};
+
+            if (settings.verbose || trace_recorder::current)
+            {
+                // each task covers one namespace and file, or one input file
+                group.on_task_complete(
+                    [&](std::string_view name, task_group::clock::duration elapsed)
+                    {
+                        if (trace_recorder::current)
+                        {
+                            auto end = trace_recorder::clock::now();
+                            trace.add_span("task", name, end - elapsed, end);
+                        }
+
+                        if (settings.verbose)
+                        {
+                            auto us
+                                = std::chrono::duration_cast<std::chrono::microseconds>(
+                                      elapsed)
+                                      .count();
+
+                            std::lock_guard lock{timings_lock};
+                            timings.emplace_back(name, us);
+                        }
+                    });
+            }
+
+            for (auto&& file : settings.input)
+            {
+                input_hashes.emplace(file, hash_value{});
+            }
+
+            // a rebuilt generator can write different output for the same
+            // inputs, even if its version string is the same
+            group.add(
+                "<hash> generator",
+                []
+                {
+                    settings.generator_hash = hash_file(get_generator_path());
+                });
+
+            for (auto&& [file, hash] : input_hashes)
+            {
+                group.add(
+                    "<hash> " + std::string{file},
+                    [file = file, &hash = hash]
+                    {
+                        hash = hash_file(std::string{file});
+                    });
+            }
+
             settings.filter = {settings.include, settings.exclude};
 
             if (settings.verbose)
@@ -139,27 +355,211 @@ Where <spec> is one or more of:
 
             w.flush_to_console();
 
-            task_group group;
-
             auto module_dir = settings.output_folder / settings.module;
             auto src_dir = module_dir / "src";
             auto system_dir = module_dir / "system";
             create_directories(src_dir);
             create_directories(system_dir);
 
-            group.add(
-                [&]
-                {
-                    write_pybase_h(src_dir);
-                    write_package_py_typed(module_dir);
-                    write_winrt_pyi(module_dir);
-                    write_system_dunder_init_py(system_dir);
-                    write_runtime_cpp(src_dir);
-                    write_winrt_module_cpp(src_dir);
-                    write_winrt_array_cpp(src_dir);
-                });
+            // a unity or pch folder left over from a run with -unity or -pch
+            // would otherwise still be used by the projection build
+            auto unity_dir = src_dir / "unity";
+            auto pch_dir = src_dir / "pch";
+
+            for (auto [dir, enabled] :
+                 {std::pair{unity_dir, settings.unity != 0},
+                  std::pair{pch_dir, settings.pch != 0}})
+            {
+                if (enabled)
+                {
+                    create_directories(dir);
+                }
+                else
+                {
+                    remove_all(dir);
+                }
+            }
+
+            // The manifest is removed until this run has finished so that an
+            // interrupted run can't leave behind hashes that don't match the
+            // files on disk.
+            auto manifest_path = module_dir / namespace_manifest::filename;
+            namespace_manifest manifest;
+
+            if (!settings.force)
+            {
+                manifest.load(manifest_path);
+            }
 
-            std::vector<std::string> generated_namespaces{};
+            std::filesystem::remove(manifest_path);
+
+            // Likewise for the digests of the output files, which let
+            // unchanged files be detected without reading them.
+            auto digests_path = module_dir / "pywinrt.digests";
+            digests.verify = settings.verify;
+            digests.load(digests_path);
+            std::filesystem::remove(digests_path);
+
+            std::atomic<uint32_t> skipped_namespaces{};
+
+            auto outputs_exist
+                = [&](std::string_view const& ns, stdfs::path const& ns_dir)
+            {
+                return exists(src_dir / ("py." + std::string{ns} + ".cpp"))
+                       && exists(src_dir / ("py." + std::string{ns} + ".h"))
+                       && exists(src_dir / ("py." + std::string{ns} + ".fwd.h"))
+                       && exists(ns_dir / "__init__.py")
+                       && exists(ns_dir / "__init__.pyi");
+            };
+
+            auto add_common_tasks = [&]
+            {
+                group.add(
+                    "<common>",
+                    [&]
+                    {
+                        write_pybase_h(src_dir);
+                        write_package_py_typed(module_dir);
+                        write_winrt_pyi(module_dir);
+                        write_system_dunder_init_py(system_dir);
+                        write_runtime_cpp(src_dir);
+                        write_winrt_module_cpp(src_dir);
+                        write_winrt_array_cpp(src_dir);
+                    });
+            };
+
+            // special case for adding additional Windows.Graphics.Capture.Interop
+            // module (the interop namespace doesn't have metadata to
+            // automatically generate it)
+            auto add_interop_tasks
+                = [&](std::string_view const& ns, stdfs::path const& ns_dir)
+            {
+                if (ns != "Windows.Graphics.Capture")
+                {
+                    return;
+                }
+
+                auto interop_dir = ns_dir / "interop";
+                create_directories(interop_dir);
+
+                group.add(
+                    "Windows.Graphics.Capture.Interop",
+                    [&src_dir, interop_dir]
+                    {
+                        write_windows_graphics_capture_interop_cpp(src_dir);
+                        write_windows_graphics_capture_interop_py(interop_dir);
+                        write_windows_graphics_capture_interop_pyi(interop_dir);
+                    });
+            };
+
+            // With -index, the analysis of the metadata from the last run is
+            // reused if the inputs and settings are the same. If the manifest
+            // also shows that every namespace is up to date, there is nothing
+            // to generate and the metadata doesn't have to be loaded at all.
+            auto index_path = module_dir / metadata_index::filename;
+            metadata_index index;
+            metadata_index::builder index_builder;
+            hash_value index_key{};
+            bool index_found{};
+
+            if (settings.index)
+            {
+                group.get();
+                index_key = hash_index_key(input_hashes);
+                index_found = !settings.force && index.open(index_path, index_key);
+            }
+
+            // the grouped build files are only written when the metadata is
+            // loaded, so the fast path can't be taken if they are missing
+            auto group_files_exist
+                = (!settings.unity || exists(unity_dir / "unity.cmake"))
+                  && (!settings.pch || exists(pch_dir / "pch.cmake"));
+
+            if (index_found && group_files_exist
+                && std::all_of(
+                    index.begin(),
+                    index.end(),
+                    [&](metadata_index::namespace_entry const& entry)
+                    {
+                        auto ns = index.name(entry);
+                        auto ns_dir = get_namespace_folder(module_dir, ns);
+                        return manifest.find(ns) == entry.input_hash
+                               && outputs_exist(ns, ns_dir);
+                    }))
+            {
+                add_common_tasks();
+
+                for (auto&& entry : index)
+                {
+                    auto ns = index.name(entry);
+                    manifest.set(ns, entry.input_hash);
+                    add_interop_tasks(ns, get_namespace_folder(module_dir, ns));
+                    skipped_namespaces++;
+                }
+
+                group.get();
+                manifest.save(manifest_path);
+                digests.save(digests_path);
+
+                if (settings.verbose)
+                {
+                    w.write("skipped: % (unchanged)\n", skipped_namespaces.load());
+                    w.write("index: up to date\n");
+                    w.write("time: %ms\n", get_elapsed_time(start));
+                }
+
+                if (trace_recorder::current)
+                {
+                    trace.save(settings.trace);
+                }
+
+                w.flush_to_console();
+                return result;
+            }
+
+            // The loading stays on this thread: winmd::reader::cache builds
+            // each database itself, in its constructor or add_database, and
+            // indexes its types into shared maps, so it can't take databases
+            // that were opened on the workers. The input hashes, which the
+            // workers may still be computing, only warm the OS file cache.
+            auto load_start = get_start_time();
+            cache c{get_files_to_cache()};
+            namespace_ids::assign(c);
+
+            // With -roots, only the types that the roots depend on are
+            // projected, and namespaces without any of them are skipped.
+            std::optional<type_name_set> reachable_types;
+
+            if (!settings.roots.empty())
+            {
+                reachable_types
+                    = get_reachable_types(c, settings.roots, settings.filter);
+
+                if (settings.verbose)
+                {
+                    w.write(
+                        "roots: % reachable types\n",
+                        static_cast<uint32_t>(reachable_types->size()));
+                }
+            }
+
+            auto load_time = get_elapsed_time(load_start);
+            auto generate_start = get_start_time();
+
+            if (trace_recorder::current)
+            {
+                trace.add_span("phase", "load", load_start, generate_start);
+            }
+
+            struct scheduled_namespace
+            {
+                std::string_view ns;
+                cache::namespace_members members;
+                uint64_t cost;
+                std::shared_ptr<namespace_dependencies const> dependencies;
+            };
+
+            std::vector<scheduled_namespace> scheduled_namespaces;
 
             for (auto&& [ns, members] : c.namespaces())
             {
@@ -168,54 +568,245 @@ Where <spec> is one or more of:
                     continue;
                 }
 
-                generated_namespaces.emplace_back(ns);
-
-                auto ns_dir = module_dir;
-                for (auto&& ns_segment : get_dotted_name_segments(ns))
+                if (reachable_types)
                 {
-                    std::string segment{ns_segment};
-                    std::transform(
-                        segment.begin(),
-                        segment.end(),
-                        segment.begin(),
-                        [](char c)
-                        {
-                            return static_cast<char>(::tolower(c));
-                        });
-                    ns_dir /= segment;
+                    auto it = reachable_types->lower_bound({ns, {}});
+
+                    if (it == reachable_types->end() || it->first != ns)
+                    {
+                        continue;
+                    }
                 }
 
+                scheduled_namespaces.push_back({ns, {}, {}, {}});
+            }
+
+            // The members of each namespace are filtered once, in parallel, and
+            // then shared by all of the writers for the namespace.
+            for (auto&& scheduled : scheduled_namespaces)
+            {
+                group.add(
+                    "<filter> " + std::string{scheduled.ns},
+                    [&scheduled,
+                     &members = c.namespaces().at(scheduled.ns),
+                     &reachable_types]
+                    {
+                        scheduled.members = filter_namespace_members(
+                            members,
+                            settings.filter,
+                            reachable_types ? &*reachable_types : nullptr);
+                        scheduled.cost = estimate_namespace_cost(scheduled.members);
+                    });
+            }
+
+            group.get();
+            add_common_tasks();
+
+            // Start the most expensive namespaces first (longest processing time
+            // first scheduling) so that a large namespace that happens to sort
+            // late alphabetically doesn't end up setting the critical path.
+            std::stable_sort(
+                scheduled_namespaces.begin(),
+                scheduled_namespaces.end(),
+                [](auto const& lhs, auto const& rhs)
+                {
+                    return lhs.cost > rhs.cost;
+                });
+
+            for (auto&& scheduled : scheduled_namespaces)
+            {
+                auto ns = scheduled.ns;
+                auto const& members = scheduled.members;
+                auto cost = scheduled.cost;
+                auto ns_dir = get_namespace_folder(module_dir, ns);
                 create_directories(ns_dir);
 
+                // Each namespace is split into a cheap task that finds the
+                // namespaces referenced by the projection followed by one task for
+                // each generated file, since that is the only dependency between
+                // the files. The namespaces come from get_needed_namespaces()
+                // rather than from the .cpp writer so that the files don't have
+                // to wait for it; see there for how the two can differ.
                 group.add(
-                    [&src_dir, ns_dir, ns = ns, members = members]
+                    std::string{ns} + " deps",
+                    [&, ns_dir, ns, cost]
                     {
-                        auto namespaces = write_namespace_cpp(src_dir, ns, members);
-                        write_namespace_h(src_dir, ns, namespaces, members);
-                        write_namespace_dunder_init_py(
-                            ns_dir, settings.module, namespaces, ns, members);
-                        write_namespace_dunder_init_pyi(
-                            ns_dir, namespaces, ns, members);
-
-                        // special case for adding additional
-                        // Windows.Graphics.Capture.Interop module (the interop
-                        // namespace doesn't have metadata to automatically generate it)
-                        if (ns == "Windows.Graphics.Capture")
+                        std::shared_ptr<namespace_dependencies const> dependencies;
+                        hash_value input_hash;
+
+                        if (auto entry = index_found ? index.find(ns) : nullptr)
                         {
-                            auto interop_dir = ns_dir / "interop";
-                            create_directories(interop_dir);
+                            dependencies
+                                = std::make_shared<namespace_dependencies const>(
+                                    index.dependencies(*entry));
+                            input_hash = entry->input_hash;
+                        }
+                        else
+                        {
+                            dependencies
+                                = std::make_shared<namespace_dependencies const>(
+                                    get_needed_namespaces(ns, members));
+                            // py.<ns>.h also depends on the namespaces whose
+                            // full headers it includes
+                            auto hashed_namespaces = dependencies->namespaces;
+                            hashed_namespaces |= dependencies->full_headers;
+                            input_hash = hash_namespace_inputs(
+                                c, ns, hashed_namespaces, input_hashes);
+                        }
 
-                            write_windows_graphics_capture_interop_cpp(src_dir);
-                            write_windows_graphics_capture_interop_py(interop_dir);
-                            write_windows_graphics_capture_interop_pyi(interop_dir);
+                        scheduled.dependencies = dependencies;
+                        manifest.set(ns, input_hash);
+
+                        if (settings.index)
+                        {
+                            index_builder.add(ns, cost, input_hash, *dependencies);
+                        }
+
+                        if (manifest.find(ns) == input_hash
+                            && outputs_exist(ns, ns_dir))
+                        {
+                            skipped_namespaces++;
+                            return;
                         }
+
+                        group.add(
+                            std::string{ns} + " cpp",
+                            [&src_dir, ns, &members, dependencies]
+                            {
+                                [[maybe_unused]] auto namespaces
+                                    = write_namespace_cpp(src_dir, ns, members);
+
+                                assert(dependencies->namespaces.includes(namespaces));
+                            });
+
+                        group.add(
+                            std::string{ns} + " fwd h",
+                            [&src_dir, ns, &members]
+                            {
+                                write_namespace_fwd_h(src_dir, ns, members);
+                            });
+
+                        group.add(
+                            std::string{ns} + " h",
+                            [&src_dir, ns, &members, dependencies]
+                            {
+                                write_namespace_h(src_dir, ns, *dependencies, members);
+                            });
+
+                        group.add(
+                            std::string{ns} + " py",
+                            [ns_dir, ns, &members, dependencies]
+                            {
+                                write_namespace_dunder_init_py(
+                                    ns_dir,
+                                    settings.module,
+                                    dependencies->namespaces,
+                                    ns,
+                                    members);
+                            });
+
+                        group.add(
+                            std::string{ns} + " pyi",
+                            [ns_dir, ns, &members, dependencies]
+                            {
+                                write_namespace_dunder_init_pyi(
+                                    ns_dir, dependencies->namespaces, ns, members);
+                            });
                     });
+
+                add_interop_tasks(ns, ns_dir);
             }
 
             group.get();
 
+            if (settings.unity || settings.pch)
+            {
+                std::vector<std::tuple<std::string_view, uint64_t, namespace_set>>
+                    grouped_namespaces;
+
+                for (auto&& scheduled : scheduled_namespaces)
+                {
+                    grouped_namespaces.emplace_back(
+                        scheduled.ns,
+                        scheduled.cost,
+                        scheduled.dependencies->namespaces);
+                }
+
+                // each unity build file is compiled with its own precompiled
+                // header, so both use the same groups
+                auto groups = group_namespaces(
+                    std::move(grouped_namespaces),
+                    settings.unity ? settings.unity : settings.pch);
+
+                if (settings.unity)
+                {
+                    write_unity_files(unity_dir, groups);
+                }
+
+                if (settings.pch)
+                {
+                    write_pch_files(pch_dir, groups);
+                }
+            }
+
+            manifest.save(manifest_path);
+            digests.save(digests_path);
+
+            if (settings.index)
+            {
+                // the previous index can't be replaced while it is mapped
+                index.close();
+                index_builder.save(index_path, index_key);
+            }
+
+            if (trace_recorder::current)
+            {
+                trace.add_span(
+                    "phase", "generate", generate_start, trace_recorder::clock::now());
+                trace.save(settings.trace);
+            }
+
             if (settings.verbose)
             {
+                // compare the estimated cost of each namespace to the time that
+                // was actually spent on it to help tune namespace_cost_weights
+                std::map<std::string_view, int64_t> namespace_times;
+
+                for (auto&& [name, us] : timings)
+                {
+                    namespace_times[std::string_view{name}.substr(0, name.find(' '))]
+                        += us;
+                }
+
+                uint64_t total_cost{};
+                int64_t total_time{};
+
+                for (auto&& scheduled : scheduled_namespaces)
+                {
+                    total_cost += scheduled.cost;
+                    total_time += namespace_times[scheduled.ns];
+                }
+
+                for (auto&& scheduled : scheduled_namespaces)
+                {
+                    auto predicted = total_cost == 0
+                                         ? 0
+                                         : static_cast<int64_t>(
+                                             static_cast<double>(scheduled.cost)
+                                             * total_time / total_cost);
+
+                    w.write(
+                        "namespace: % (cost: %, predicted: %ms, actual: %ms)\n",
+                        scheduled.ns,
+                        scheduled.cost,
+                        predicted / 1000,
+                        namespace_times[scheduled.ns] / 1000);
+                }
+
+                w.write("skipped: % (unchanged)\n", skipped_namespaces.load());
+                w.write("jobs: %\n", task_group::get_job_count(settings.jobs));
+                w.write("load: %ms\n", load_time);
+                w.write("generate: %ms\n", get_elapsed_time(generate_start));
                 w.write("time: %ms\n", get_elapsed_time(start));
             }
         }
@@ -0,0 +1,187 @@
+#pragma once
+
+namespace pywinrt
+{
+    /**
+     * Records a hash of the inputs that each namespace was generated from so
+     * that namespaces whose inputs have not changed can be skipped on the
+     * next run.
+     *
+     * The manifest is a text file with a header line followed by one
+     * "<namespace> <hash>" line per generated namespace.
+     */
+    struct namespace_manifest
+    {
+        static constexpr std::string_view filename{"pywinrt.manifest"};
+
+        /**
+         * Loads the hashes recorded by a previous run, if any.
+         */
+        void load(std::filesystem::path const& path)
+        {
+            std::ifstream file{path};
+            std::string line;
+
+            if (!std::getline(file, line) || line != header)
+            {
+                return;
+            }
+
+            while (std::getline(file, line))
+            {
+                auto separator = line.rfind(' ');
+
+                if (separator == std::string::npos)
+                {
+                    continue;
+                }
+
+                if (auto hash = parse_hash_value(
+                        std::string_view{line}.substr(separator + 1)))
+                {
+                    m_previous.emplace(line.substr(0, separator), *hash);
+                }
+            }
+        }
+
+        /**
+         * Writes the hashes recorded by this run.
+         */
+        void save(std::filesystem::path const& path) const
+        {
+            std::ofstream file{path, std::ios::out | std::ios::binary};
+            file << header << '\n';
+
+            for (auto&& [ns, hash] : m_current)
+            {
+                file << ns << ' ' << to_string(hash) << '\n';
+            }
+        }
+
+        /**
+         * Gets the hash recorded for a namespace by the previous run.
+         */
+        std::optional<hash_value> find(std::string_view const& ns) const
+        {
+            auto it = m_previous.find(ns);
+
+            if (it == m_previous.end())
+            {
+                return std::nullopt;
+            }
+
+            return it->second;
+        }
+
+        /**
+         * Records the hash of a namespace generated by this run. This may be
+         * called concurrently.
+         */
+        void set(std::string_view const& ns, hash_value const& hash)
+        {
+            std::lock_guard lock{m_lock};
+            m_current.insert_or_assign(std::string{ns}, hash);
+        }
+
+      private:
+        static constexpr std::string_view header{"pywinrt-manifest 1"};
+
+        std::map<std::string, hash_value, std::less<>> m_previous;
+        std::map<std::string, hash_value, std::less<>> m_current;
+        std::mutex m_lock;
+    };
+
+    inline hash_value hash_file(std::string const& path)
+    {
+        file_view file{path};
+        return hash_bytes(file.begin(), file.size());
+    }
+
+    /**
+     * Adds the generator version and executable and the settings that change
+     * the output.
+     */
+    inline void hash_settings(hasher& h)
+    {
+        h.update_string(PYWINRT_VERSION_STRING);
+        h.update(&settings.generator_hash, sizeof(settings.generator_hash));
+        h.update_string(settings.module);
+
+        for (auto&& include : settings.include)
+        {
+            h.update_string("include");
+            h.update_string(include);
+        }
+
+        for (auto&& exclude : settings.exclude)
+        {
+            h.update_string("exclude");
+            h.update_string(exclude);
+        }
+
+        for (auto&& root : settings.roots)
+        {
+            h.update_string("root");
+            h.update_string(root);
+        }
+    }
+
+    /**
+     * Computes the hash of everything that the generated files for a namespace
+     * depend on: the generator version, the settings that change the output,
+     * and the contents of each winmd that defines a type in the namespace or
+     * in one of the namespaces it references.
+     * @param input_hashes The hash of each input file, from hash_file().
+     */
+    inline hash_value hash_namespace_inputs(
+        cache const& c,
+        std::string_view const& ns,
+        namespace_set const& needed_namespaces,
+        std::map<std::string_view, hash_value> const& input_hashes)
+    {
+        hasher h;
+        hash_settings(h);
+        h.update_string(ns);
+
+        std::set<std::string_view> files;
+
+        auto add_files = [&](std::string_view const& name)
+        {
+            auto it = c.namespaces().find(name);
+
+            if (it == c.namespaces().end())
+            {
+                return;
+            }
+
+            for (auto&& type : it->second.types)
+            {
+                files.insert(type.second.get_database().path());
+            }
+        };
+
+        add_files(ns);
+
+        for (auto&& needed_ns : needed_namespaces)
+        {
+            add_files(needed_ns);
+        }
+
+        // the types that -roots reaches in this namespace can depend on any input
+        if (!settings.roots.empty())
+        {
+            for (auto&& [file, hash] : input_hashes)
+            {
+                files.insert(file);
+            }
+        }
+
+        for (auto&& file : files)
+        {
+            auto hash = input_hashes.at(file);
+            h.update(&hash, sizeof(hash));
+        }
+
+        return h.finish();
+    }
+} // namespace pywinrt
@@ -0,0 +1,390 @@
+#pragma once
+
+namespace pywinrt
+{
+    /**
+     * The results of analyzing the input metadata that decide what a run has to
+     * generate: the projected namespaces, their estimated cost, the hash of
+     * their inputs and the namespaces that each one depends on.
+     *
+     * When the -index option is used, the index is saved next to the namespace
+     * manifest. A later run with the same inputs and settings can then tell
+     * that every namespace is up to date without loading the metadata at all,
+     * and can reuse the dependencies of the namespaces that it does generate.
+     *
+     * The file only contains offsets, never pointers, so it is used in place
+     * from a read-only mapping that can be shared by all worker threads. It is
+     * laid out as:
+     *
+     *     header
+     *     namespace_entry[namespace_count] (sorted by name)
+     *     uint32_t dependencies[dependency_count] (indices into names, the
+     *         dependencies of each entry followed by its full headers)
+     *     name_entry[name_count]
+     *     char strings[string_size]
+     */
+    struct metadata_index
+    {
+        static constexpr std::string_view filename{"pywinrt.index"};
+
+        struct namespace_entry
+        {
+            uint32_t name;
+            uint32_t first_dependency;
+            uint32_t dependency_count;
+            uint32_t full_header_count;
+            uint64_t cost;
+            hash_value input_hash;
+        };
+
+        /**
+         * Collects the entries for a run and writes them to a new index.
+         */
+        struct builder
+        {
+            /**
+             * Adds a projected namespace. This may be called concurrently.
+             */
+            void add(
+                std::string_view const& ns,
+                uint64_t cost,
+                hash_value const& input_hash,
+                namespace_dependencies const& dependencies)
+            {
+                std::lock_guard lock{m_lock};
+                auto& entry = m_namespaces[std::string{ns}];
+                entry.cost = cost;
+                entry.input_hash = input_hash;
+                entry.dependencies.assign(
+                    dependencies.namespaces.begin(), dependencies.namespaces.end());
+                entry.full_headers.assign(
+                    dependencies.full_headers.begin(), dependencies.full_headers.end());
+            }
+
+            void save(std::filesystem::path const& path, hash_value const& key) const
+            {
+                std::map<std::string_view, uint32_t> names;
+
+                for (auto&& [ns, entry] : m_namespaces)
+                {
+                    names.emplace(ns, 0);
+
+                    for (auto&& dependency : entry.dependencies)
+                    {
+                        names.emplace(dependency, 0);
+                    }
+
+                    for (auto&& full_header : entry.full_headers)
+                    {
+                        names.emplace(full_header, 0);
+                    }
+                }
+
+                std::vector<name_entry> name_entries;
+                std::string strings;
+
+                for (auto&& [name, id] : names)
+                {
+                    id = static_cast<uint32_t>(name_entries.size());
+                    name_entries.push_back(
+                        {static_cast<uint32_t>(strings.size()),
+                         static_cast<uint32_t>(name.size())});
+                    strings += name;
+                }
+
+                std::vector<namespace_entry> namespace_entries;
+                std::vector<uint32_t> dependencies;
+
+                for (auto&& [ns, entry] : m_namespaces)
+                {
+                    namespace_entries.push_back(
+                        {names.at(ns),
+                         static_cast<uint32_t>(dependencies.size()),
+                         static_cast<uint32_t>(entry.dependencies.size()),
+                         static_cast<uint32_t>(entry.full_headers.size()),
+                         entry.cost,
+                         entry.input_hash});
+
+                    for (auto&& dependency : entry.dependencies)
+                    {
+                        dependencies.push_back(names.at(dependency));
+                    }
+
+                    for (auto&& full_header : entry.full_headers)
+                    {
+                        dependencies.push_back(names.at(full_header));
+                    }
+                }
+
+                header h{};
+                std::memcpy(h.magic, magic.data(), sizeof(h.magic));
+                h.key = key;
+                h.namespace_count = static_cast<uint32_t>(namespace_entries.size());
+                h.dependency_count = static_cast<uint32_t>(dependencies.size());
+                h.name_count = static_cast<uint32_t>(name_entries.size());
+                h.string_size = static_cast<uint32_t>(strings.size());
+
+                std::ofstream file{path, std::ios::out | std::ios::binary};
+                write_array(file, &h, 1);
+                write_array(file, namespace_entries.data(), namespace_entries.size());
+                write_array(file, dependencies.data(), dependencies.size());
+                write_array(file, name_entries.data(), name_entries.size());
+                write_array(file, strings.data(), strings.size());
+            }
+
+          private:
+            struct entry
+            {
+                uint64_t cost;
+                hash_value input_hash;
+                std::vector<std::string> dependencies;
+                std::vector<std::string> full_headers;
+            };
+
+            template<typename T>
+            static void write_array(std::ofstream& file, T const* data, size_t count)
+            {
+                file.write(reinterpret_cast<char const*>(data), sizeof(T) * count);
+            }
+
+            std::map<std::string, entry, std::less<>> m_namespaces;
+            std::mutex m_lock;
+        };
+
+        /**
+         * Maps the index saved by a previous run.
+         * @returns false if there is no index or it was saved with a different
+         * @p key, in which case the index is empty.
+         */
+        bool open(std::filesystem::path const& path, hash_value const& key)
+        {
+            std::error_code ec;
+            auto size = std::filesystem::file_size(path, ec);
+
+            if (ec || size < sizeof(header))
+            {
+                return false;
+            }
+
+            m_file.emplace(path.string());
+            auto base = m_file->begin();
+            auto h = reinterpret_cast<header const*>(base);
+
+            if (std::string_view{h->magic, sizeof(h->magic)} != magic || h->key != key)
+            {
+                m_file.reset();
+                return false;
+            }
+
+            auto expected_size = sizeof(header)
+                                 + sizeof(namespace_entry) * h->namespace_count
+                                 + sizeof(uint32_t) * h->dependency_count
+                                 + sizeof(name_entry) * h->name_count + h->string_size;
+
+            if (m_file->size() != expected_size)
+            {
+                m_file.reset();
+                return false;
+            }
+
+            auto next = base + sizeof(header);
+            m_namespaces = read_array<namespace_entry>(next, h->namespace_count);
+            m_dependencies = read_array<uint32_t>(next, h->dependency_count);
+            m_names = read_array<name_entry>(next, h->name_count);
+            m_strings = read_array<char>(next, h->string_size);
+
+            if (!is_valid())
+            {
+                close();
+                return false;
+            }
+
+            return true;
+        }
+
+        /**
+         * Unmaps the index.
+         */
+        void close() noexcept
+        {
+            m_file.reset();
+            m_namespaces = {};
+            m_dependencies = {};
+            m_names = {};
+            m_strings = {};
+        }
+
+        namespace_entry const* begin() const noexcept
+        {
+            return m_namespaces.data;
+        }
+
+        namespace_entry const* end() const noexcept
+        {
+            return m_namespaces.data + m_namespaces.size;
+        }
+
+        std::string_view name(namespace_entry const& entry) const noexcept
+        {
+            return name(entry.name);
+        }
+
+        /**
+         * Finds the entry for a projected namespace.
+         */
+        namespace_entry const* find(std::string_view const& ns) const noexcept
+        {
+            auto it = std::lower_bound(
+                begin(),
+                end(),
+                ns,
+                [this](namespace_entry const& entry, std::string_view const& ns)
+                {
+                    return name(entry) < ns;
+                });
+
+            return it != end() && name(*it) == ns ? it : nullptr;
+        }
+
+        /**
+         * Gets the namespaces that @p entry depends on. The namespace IDs must
+         * have been assigned.
+         */
+        namespace_dependencies dependencies(namespace_entry const& entry) const
+        {
+            namespace_dependencies result;
+            auto first = m_dependencies.data + entry.first_dependency;
+
+            for (uint32_t i{}; i < entry.dependency_count; i++)
+            {
+                result.namespaces.insert(name(first[i]));
+            }
+
+            for (uint32_t i{}; i < entry.full_header_count; i++)
+            {
+                result.full_headers.insert(name(first[entry.dependency_count + i]));
+            }
+
+            return result;
+        }
+
+      private:
+        static constexpr std::string_view magic{"pywinrt-index-2\0", 16};
+
+        struct header
+        {
+            char magic[16];
+            hash_value key;
+            uint32_t namespace_count;
+            uint32_t dependency_count;
+            uint32_t name_count;
+            uint32_t string_size;
+        };
+
+        struct name_entry
+        {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        template<typename T>
+        struct array_view
+        {
+            T const* data{};
+            uint32_t size{};
+        };
+
+        template<typename T>
+        static array_view<T> read_array(uint8_t const*& next, uint32_t count) noexcept
+        {
+            array_view<T> result{reinterpret_cast<T const*>(next), count};
+            next += sizeof(T) * count;
+            return result;
+        }
+
+        static_assert(sizeof(header) % alignof(namespace_entry) == 0);
+        static_assert(sizeof(namespace_entry) % alignof(uint32_t) == 0);
+        static_assert(alignof(name_entry) == alignof(uint32_t));
+
+        std::string_view name(uint32_t id) const noexcept
+        {
+            auto const& entry = m_names.data[id];
+            return {m_strings.data + entry.offset, entry.size};
+        }
+
+        /**
+         * Checks that every offset in the index is in range, so that a damaged
+         * file is ignored rather than read out of bounds.
+         */
+        bool is_valid() const noexcept
+        {
+            for (uint32_t i{}; i < m_names.size; i++)
+            {
+                auto const& entry = m_names.data[i];
+
+                if (entry.offset > m_strings.size
+                    || entry.size > m_strings.size - entry.offset)
+                {
+                    return false;
+                }
+            }
+
+            for (uint32_t i{}; i < m_dependencies.size; i++)
+            {
+                if (m_dependencies.data[i] >= m_names.size)
+                {
+                    return false;
+                }
+            }
+
+            for (uint32_t i{}; i < m_namespaces.size; i++)
+            {
+                auto const& entry = m_namespaces.data[i];
+
+                if (entry.name >= m_names.size
+                    || entry.first_dependency > m_dependencies.size
+                    || entry.dependency_count
+                           > m_dependencies.size - entry.first_dependency
+                    || entry.full_header_count > m_dependencies.size
+                                                     - entry.first_dependency
+                                                     - entry.dependency_count)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        std::optional<file_view> m_file;
+        array_view<namespace_entry> m_namespaces;
+        array_view<uint32_t> m_dependencies;
+        array_view<name_entry> m_names;
+        array_view<char> m_strings;
+    };
+
+    /**
+     * Computes the key of the metadata index for this run from the settings
+     * that change the output and the path and contents of each input file.
+     * @param input_hashes The hash of each input file, from hash_file().
+     */
+    inline hash_value hash_index_key(
+        std::map<std::string_view, hash_value> const& input_hashes)
+    {
+        hasher h;
+        hash_settings(h);
+
+        // the unity build files and precompiled headers are only written when
+        // the metadata is loaded
+        h.update(&settings.unity, sizeof(settings.unity));
+        h.update(&settings.pch, sizeof(settings.pch));
+
+        for (auto&& [file, hash] : input_hashes)
+        {
+            h.update_string(file);
+            h.update(&hash, sizeof(hash));
+        }
+
+        return h.finish();
+    }
+} // namespace pywinrt
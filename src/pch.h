@@ -3,5 +3,7 @@
 #include <winmd_reader.h>
 
 #include "cmd_reader.h"
+#include "hash.h"
 #include "task_group.h"
+#include "trace.h"
 #include "text_writer.h"
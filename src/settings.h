@@ -9,10 +9,22 @@ namespace pywinrt
         std::filesystem::path output_folder;
         std::string module{"pyrt"};
         bool verbose{};
+        uint32_t jobs{};
+        bool force{};
+        bool verify{};
+        bool index{};
+        std::filesystem::path trace;
+        uint32_t unity{};
+        uint32_t pch{};
 
         std::set<std::string> include;
         std::set<std::string> exclude;
+        std::set<std::string> roots;
         winmd::reader::filter filter;
+
+        // the hash of the generator executable, which is part of the settings
+        // hash so that a rebuilt generator regenerates everything
+        hash_value generator_hash{};
     };
 
     extern settings_type settings;
@@ -4,47 +4,287 @@
 
 namespace pywinrt
 {
+    /**
+     * Runs callbacks on a fixed number of worker threads.
+     *
+     * Each worker owns a queue of pending tasks. Workers take work from the
+     * front of their own queue and steal from the front of the other queues
+     * when their own queue is empty, so the number of OS threads stays bounded
+     * by the number of jobs no matter how many tasks are added.
+     *
+     * Tasks added from outside of the group are started in the order they were
+     * added, so callers can schedule the most expensive work first. Tasks added
+     * by a running task are started before any other work on that worker, also
+     * in the order they were added (and may be stolen by idle workers).
+     */
     struct task_group
     {
+        using clock = std::chrono::high_resolution_clock;
+        using timing_callback
+            = std::function<void(std::string_view name, clock::duration elapsed)>;
+
         task_group(task_group const&) = delete;
         task_group& operator=(task_group const&) = delete;
 
-        task_group() noexcept = default;
+        /**
+         * Creates a new task group.
+         * @param jobs The number of worker threads or 0 to use the number of
+         * hardware threads.
+         */
+        explicit task_group(uint32_t jobs = 0) : m_queues(get_job_count(jobs))
+        {
+#if !defined(XLANG_DEBUG)
+            for (size_t i{}; i < m_queues.size(); i++)
+            {
+                m_workers.emplace_back(
+                    [this, i]
+                    {
+                        run_worker(i);
+                    });
+            }
+#endif
+        }
 
         ~task_group() noexcept
         {
-            for (auto&& task : m_tasks)
+            wait();
+
+            {
+                std::lock_guard lock{m_lock};
+                m_stopping = true;
+            }
+
+            m_wake.notify_all();
+
+            for (auto&& worker : m_workers)
             {
-                task.wait();
+                worker.join();
             }
         }
 
+        /**
+         * Sets a function that is called on the worker thread each time a
+         * task completes. The function may be called concurrently.
+         */
+        void on_task_complete(timing_callback callback)
+        {
+            m_on_task_complete = std::move(callback);
+        }
+
         template<typename T>
         void add(T&& callback)
         {
+            add({}, std::forward<T>(callback));
+        }
+
+        template<typename T>
+        void add(std::string name, T&& callback)
+        {
+            task t{std::move(name), std::forward<T>(callback), t_current_batch};
+
 #if defined(XLANG_DEBUG)
-            callback();
+            execute(t);
 #else
-            m_tasks.push_back(std::async(std::forward<T>(callback)));
+            m_pending.fetch_add(1);
+
+            // tasks added from a worker go to the front of the line for that
+            // worker, after the ones already added by the same task, otherwise
+            // they are spread across all workers
+            if (t_worker_owner == this)
+            {
+                auto& queue = m_queues[t_worker_index];
+                std::lock_guard lock{queue.lock};
+                auto position = std::find_if(
+                    queue.tasks.begin(),
+                    queue.tasks.end(),
+                    [](task const& queued)
+                    {
+                        return queued.batch != t_current_batch;
+                    });
+                queue.tasks.insert(position, std::move(t));
+            }
+            else
+            {
+                auto& queue = m_queues[m_next_queue.fetch_add(1) % m_queues.size()];
+                std::lock_guard lock{queue.lock};
+                queue.tasks.push_back(std::move(t));
+            }
+
+            {
+                std::lock_guard lock{m_lock};
+                m_queued++;
+            }
+
+            m_wake.notify_one();
 #endif
         }
 
+        /**
+         * Waits for all tasks to complete.
+         * @throws The first exception thrown by a task, if any.
+         */
         void get()
         {
-            auto tasks = std::move(m_tasks);
+            wait();
 
-            for (auto&& task : tasks)
+            if (auto error = std::exchange(m_error, nullptr))
             {
-                task.wait();
+                std::rethrow_exception(error);
             }
+        }
 
-            for (auto&& task : tasks)
+        static uint32_t get_job_count(uint32_t jobs) noexcept
+        {
+            if (jobs == 0)
             {
-                task.get();
+                jobs = std::max(1u, std::thread::hardware_concurrency());
             }
+
+            return jobs;
         }
 
       private:
-        std::vector<std::future<void>> m_tasks;
+        struct task
+        {
+            std::string name;
+            std::function<void()> callback;
+
+            // the run of the task that added this one, or 0 if it was added
+            // from outside of the group
+            uint64_t batch;
+        };
+
+        struct task_queue
+        {
+            std::mutex lock;
+            std::deque<task> tasks;
+        };
+
+        void wait() noexcept
+        {
+            std::unique_lock lock{m_lock};
+            m_done.wait(
+                lock,
+                [this]
+                {
+                    return m_pending.load() == 0;
+                });
+        }
+
+        void execute(task& t) noexcept
+        {
+            auto start = clock::now();
+            auto outer_batch
+                = std::exchange(t_current_batch, m_next_batch.fetch_add(1) + 1);
+
+            try
+            {
+                t.callback();
+            }
+            catch (...)
+            {
+                std::lock_guard lock{m_error_lock};
+
+                if (!m_error)
+                {
+                    m_error = std::current_exception();
+                }
+            }
+
+            t_current_batch = outer_batch;
+
+            if (m_on_task_complete)
+            {
+                m_on_task_complete(t.name, clock::now() - start);
+            }
+        }
+
+        bool try_pop(size_t index, task& t)
+        {
+            // start with our own queue, then try to steal from the others
+            for (size_t i{}; i < m_queues.size(); i++)
+            {
+                auto& queue = m_queues[(index + i) % m_queues.size()];
+                std::lock_guard lock{queue.lock};
+
+                if (queue.tasks.empty())
+                {
+                    continue;
+                }
+
+                t = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+
+                return true;
+            }
+
+            return false;
+        }
+
+        void run_worker(size_t index)
+        {
+            t_worker_owner = this;
+            t_worker_index = index;
+
+            while (true)
+            {
+                {
+                    std::unique_lock lock{m_lock};
+                    m_wake.wait(
+                        lock,
+                        [this]
+                        {
+                            return m_stopping || m_queued > 0;
+                        });
+
+                    if (m_queued == 0)
+                    {
+                        return;
+                    }
+
+                    m_queued--;
+                }
+
+                // The claim above guarantees that a task is queued, but the
+                // queues are checked one at a time, so another worker can take
+                // it from a queue that was already checked while one added
+                // behind it goes unseen. Keep looking until one is found.
+                task t;
+
+                while (!try_pop(index, t))
+                {
+                    std::this_thread::yield();
+                }
+
+                execute(t);
+
+                if (m_pending.fetch_sub(1) == 1)
+                {
+                    std::lock_guard lock{m_lock};
+                    m_done.notify_all();
+                }
+            }
+        }
+
+        static inline thread_local task_group* t_worker_owner{};
+        static inline thread_local size_t t_worker_index{};
+        static inline thread_local uint64_t t_current_batch{};
+
+        std::vector<task_queue> m_queues;
+        std::vector<std::thread> m_workers;
+        std::atomic<size_t> m_next_queue{};
+        std::atomic<size_t> m_pending{};
+        std::atomic<uint64_t> m_next_batch{};
+
+        std::mutex m_lock;
+        std::condition_variable m_wake;
+        std::condition_variable m_done;
+        size_t m_queued{};
+        bool m_stopping{};
+
+        std::mutex m_error_lock;
+        std::exception_ptr m_error;
+
+        timing_callback m_on_task_complete;
     };
 } // namespace pywinrt
@@ -1,19 +1,546 @@
 #pragma once
 
 #include "impl/pywinrt_base.h"
+#include "hash.h"
+#include "trace.h"
 
 namespace pywinrt::text
 {
+    /**
+     * Records the size and hash of each file written by writer_base so that
+     * later runs can tell whether the output changed without reading back
+     * the existing file.
+     *
+     * The store is a text file with a header line followed by one
+     * "<hash> <size> <path>" line per file.
+     */
+    struct digest_store
+    {
+        struct digest
+        {
+            uint64_t size{};
+            hash_value hash;
+
+            bool operator==(digest const& other) const noexcept
+            {
+                return size == other.size && hash == other.hash;
+            }
+
+            bool operator!=(digest const& other) const noexcept
+            {
+                return !(*this == other);
+            }
+        };
+
+        /**
+         * When set, existing files are still compared byte for byte with the
+         * new output when their recorded digest matches.
+         */
+        bool verify{};
+
+        void load(std::filesystem::path const& path)
+        {
+            std::ifstream file{path};
+            std::string line;
+
+            if (!std::getline(file, line) || line != header)
+            {
+                return;
+            }
+
+            while (std::getline(file, line))
+            {
+                auto hash_end = line.find(' ');
+                auto size_end = line.find(' ', hash_end + 1);
+
+                if (size_end == std::string::npos)
+                {
+                    continue;
+                }
+
+                auto hash
+                    = parse_hash_value(std::string_view{line}.substr(0, hash_end));
+
+                if (!hash)
+                {
+                    continue;
+                }
+
+                uint64_t size{};
+                auto size_text = std::string_view{line}.substr(
+                    hash_end + 1, size_end - hash_end - 1);
+                auto [end, ec] = std::from_chars(
+                    size_text.data(), size_text.data() + size_text.size(), size);
+
+                if (ec != std::errc{} || end != size_text.data() + size_text.size())
+                {
+                    continue;
+                }
+
+                m_digests.insert_or_assign(
+                    line.substr(size_end + 1), digest{size, *hash});
+            }
+        }
+
+        void save(std::filesystem::path const& path) const
+        {
+            std::lock_guard lock{m_lock};
+            std::ofstream file{path, std::ios::out | std::ios::binary};
+            file << header << '\n';
+
+            for (auto&& [filename, value] : m_digests)
+            {
+                file << to_string(value.hash) << ' ' << value.size << ' ' << filename
+                     << '\n';
+            }
+        }
+
+        std::optional<digest> find(std::string const& filename) const
+        {
+            std::lock_guard lock{m_lock};
+            auto it = m_digests.find(filename);
+
+            if (it == m_digests.end())
+            {
+                return std::nullopt;
+            }
+
+            return it->second;
+        }
+
+        void set(std::string const& filename, digest const& value)
+        {
+            std::lock_guard lock{m_lock};
+            m_digests.insert_or_assign(filename, value);
+        }
+
+      private:
+        static constexpr std::string_view header{"pywinrt-digests 1"};
+
+        std::map<std::string, digest> m_digests;
+        mutable std::mutex m_lock;
+    };
+
+    /**
+     * A text buffer made of fixed-size chunks.
+     *
+     * Appending never moves text that was already written, and moving a
+     * buffer only moves the list of chunks. Chunks are recycled through a
+     * small per-thread pool, so writers that are created and destroyed over
+     * and over on the same worker thread don't go back to the heap.
+     */
+    struct chunked_buffer
+    {
+        static constexpr size_t chunk_size{64 * 1024};
+
+        chunked_buffer() noexcept = default;
+        chunked_buffer(chunked_buffer const&) = delete;
+        chunked_buffer& operator=(chunked_buffer const&) = delete;
+
+        chunked_buffer(chunked_buffer&& other) noexcept
+            : m_chunks(std::move(other.m_chunks)),
+              m_size(std::exchange(other.m_size, 0))
+        {
+        }
+
+        chunked_buffer& operator=(chunked_buffer&& other) noexcept
+        {
+            clear();
+            m_chunks = std::move(other.m_chunks);
+            m_size = std::exchange(other.m_size, 0);
+            return *this;
+        }
+
+        ~chunked_buffer() noexcept
+        {
+            clear();
+        }
+
+        size_t size() const noexcept
+        {
+            return m_size;
+        }
+
+        bool empty() const noexcept
+        {
+            return m_size == 0;
+        }
+
+        char back() const noexcept
+        {
+            if (m_size == 0)
+            {
+                return char{};
+            }
+
+            auto const& tail = *m_chunks.back();
+            return tail.data[tail.size - 1];
+        }
+
+        void append(std::string_view value)
+        {
+            while (!value.empty())
+            {
+                auto& tail = writable_tail();
+                auto count = std::min(value.size(), chunk_size - tail.size);
+                std::memcpy(tail.data + tail.size, value.data(), count);
+                tail.size += count;
+                m_size += count;
+                value.remove_prefix(count);
+            }
+        }
+
+        void push_back(char const value)
+        {
+            auto& tail = writable_tail();
+            tail.data[tail.size++] = value;
+            m_size++;
+        }
+
+        /**
+         * Moves the chunks of another buffer to the end of this one without
+         * copying the text, leaving the other buffer empty.
+         */
+        void append(chunked_buffer&& other)
+        {
+            m_chunks.insert(
+                m_chunks.end(),
+                std::make_move_iterator(other.m_chunks.begin()),
+                std::make_move_iterator(other.m_chunks.end()));
+            m_size += std::exchange(other.m_size, 0);
+            other.m_chunks.clear();
+        }
+
+        /**
+         * Copies the text from offset to the end of the buffer.
+         */
+        std::string substr(size_t offset) const
+        {
+            std::string result;
+            result.reserve(m_size - offset);
+
+            for_each_span(
+                [&](std::string_view span)
+                {
+                    if (offset >= span.size())
+                    {
+                        offset -= span.size();
+                        return;
+                    }
+
+                    result.append(span.substr(offset));
+                    offset = 0;
+                });
+
+            return result;
+        }
+
+        /**
+         * Removes text from the end of the buffer so that it is size chars
+         * long.
+         */
+        void truncate(size_t size) noexcept
+        {
+            assert(size <= m_size);
+
+            while (m_size > size)
+            {
+                auto& tail = *m_chunks.back();
+                auto count = std::min(tail.size, m_size - size);
+                tail.size -= count;
+                m_size -= count;
+
+                if (tail.size == 0)
+                {
+                    release(std::move(m_chunks.back()));
+                    m_chunks.pop_back();
+                }
+            }
+        }
+
+        void clear() noexcept
+        {
+            for (auto&& chunk : m_chunks)
+            {
+                release(std::move(chunk));
+            }
+
+            m_chunks.clear();
+            m_size = 0;
+        }
+
+        /**
+         * Calls f with a string_view for each chunk except the last one, in
+         * order, and removes those chunks from the buffer.
+         */
+        template<typename F>
+        void drain_full_chunks(F&& f)
+        {
+            if (m_chunks.size() < 2)
+            {
+                return;
+            }
+
+            auto last = std::prev(m_chunks.end());
+
+            for (auto it = m_chunks.begin(); it != last; ++it)
+            {
+                f(std::string_view{(*it)->data, (*it)->size});
+                m_size -= (*it)->size;
+                release(std::move(*it));
+            }
+
+            m_chunks.erase(m_chunks.begin(), last);
+        }
+
+        size_t chunk_count() const noexcept
+        {
+            return m_chunks.size();
+        }
+
+        /**
+         * Calls f with a string_view for each chunk, in order.
+         */
+        template<typename F>
+        void for_each_span(F&& f) const
+        {
+            for (auto&& chunk : m_chunks)
+            {
+                f(std::string_view{chunk->data, chunk->size});
+            }
+        }
+
+      private:
+        struct chunk
+        {
+            size_t size{};
+            char data[chunk_size];
+        };
+
+        using chunk_ptr = std::unique_ptr<chunk>;
+
+        // enough chunks for the largest files a single writer produces
+        static constexpr size_t max_pooled_chunks{64};
+
+        static std::vector<chunk_ptr>& pool() noexcept
+        {
+            static thread_local std::vector<chunk_ptr> chunks;
+            return chunks;
+        }
+
+        static void release(chunk_ptr&& c) noexcept
+        {
+            auto& chunks = pool();
+
+            if (chunks.size() < max_pooled_chunks)
+            {
+                c->size = 0;
+                chunks.push_back(std::move(c));
+            }
+            else
+            {
+                c.reset();
+            }
+        }
+
+        chunk& writable_tail()
+        {
+            if (m_chunks.empty() || m_chunks.back()->size == chunk_size)
+            {
+                auto& chunks = pool();
+
+                if (chunks.empty())
+                {
+                    // default-initialized, since zero-filling 64 KB that is
+                    // about to be overwritten would cost more than the pool saves
+                    // (make_unique_for_overwrite needs C++20)
+                    m_chunks.push_back(chunk_ptr{new chunk});
+                    trace_count(trace_recorder::counter::chunk_allocations);
+                }
+                else
+                {
+                    m_chunks.push_back(std::move(chunks.back()));
+                    chunks.pop_back();
+                }
+            }
+
+            return *m_chunks.back();
+        }
+
+        std::vector<chunk_ptr> m_chunks;
+        size_t m_size{};
+    };
+
+    /**
+     * Returns the index of the lowest set bit. value must not be 0.
+     */
+    inline uint32_t count_trailing_zeros(uint32_t value) noexcept
+    {
+        assert(value != 0);
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+    }
+
+    /**
+     * Returns a pointer to the first '\n' in [first, last) or last if there
+     * isn't one. Compares 32 or 16 chars at a time when AVX2 or SSE2 is
+     * available at compile time.
+     */
+    inline char const* find_newline(char const* first, char const* last) noexcept
+    {
+#if defined(__AVX2__)
+        auto const newlines32 = _mm256_set1_epi8('\n');
+
+        for (; last - first >= 32; first += 32)
+        {
+            auto chars = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(first));
+            auto mask = static_cast<uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, newlines32)));
+
+            if (mask != 0)
+            {
+                return first + count_trailing_zeros(mask);
+            }
+        }
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        auto const newlines16 = _mm_set1_epi8('\n');
+
+        for (; last - first >= 16; first += 16)
+        {
+            auto chars = _mm_loadu_si128(reinterpret_cast<__m128i const*>(first));
+            auto mask = static_cast<uint32_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(chars, newlines16)));
+
+            if (mask != 0)
+            {
+                return first + count_trailing_zeros(mask);
+            }
+        }
+#endif
+
+        auto newline = static_cast<char const*>(
+            std::memchr(first, '\n', static_cast<size_t>(last - first)));
+        return newline ? newline : last;
+    }
+
+    /**
+     * A piece of a format string: either literal text or a placeholder for
+     * the argument at index arg.
+     */
+    struct format_segment
+    {
+        enum class kind : uint8_t
+        {
+            text,
+            value, // '%' placeholder
+            code, // '@' placeholder
+        };
+
+        kind type{};
+        std::string_view text;
+        uint32_t arg{};
+    };
+
+    /**
+     * Splits a format string into literal text and placeholders. '^' escapes
+     * the next character. When segments is null, only counts the segments.
+     */
+    constexpr size_t split_format(
+        std::string_view const& format, format_segment* segments = nullptr) noexcept
+    {
+        size_t count{};
+        uint32_t arg{};
+        size_t start{};
+
+        auto add = [&](format_segment::kind type, size_t offset, size_t size)
+        {
+            if (type == format_segment::kind::text && size == 0)
+            {
+                return;
+            }
+
+            if (segments)
+            {
+                segments[count] = {type, format.substr(offset, size), arg};
+            }
+
+            if (type != format_segment::kind::text)
+            {
+                arg++;
+            }
+
+            count++;
+        };
+
+        for (size_t i{}; i < format.size(); i++)
+        {
+            auto c = format[i];
+
+            if (c == '^')
+            {
+                add(format_segment::kind::text, start, i - start);
+                start = ++i;
+            }
+            else if (c == '%' || c == '@')
+            {
+                add(format_segment::kind::text, start, i - start);
+                add(c == '%' ? format_segment::kind::value : format_segment::kind::code,
+                    i,
+                    0);
+                start = i + 1;
+            }
+        }
+
+        add(format_segment::kind::text, start, format.size() - start);
+        return count;
+    }
+
+    /**
+     * A format string that is split into text and placeholders at compile
+     * time. Use the PYWINRT_FORMAT macro to create one from a string literal.
+     */
+    template<typename Source>
+    struct format_string
+    {
+        static constexpr std::string_view text{Source::value()};
+
+        static constexpr auto segments = []
+        {
+            std::array<format_segment, split_format(text)> result{};
+            split_format(text, result.data());
+            return result;
+        }();
+
+        static constexpr uint32_t placeholder_count = []
+        {
+            uint32_t count{};
+
+            for (auto&& segment : segments)
+            {
+                if (segment.type != format_segment::kind::text)
+                {
+                    count++;
+                }
+            }
+
+            return count;
+        }();
+    };
+
     template<typename T>
     struct writer_base
     {
         writer_base(writer_base const&) = delete;
         writer_base& operator=(writer_base const&) = delete;
 
-        writer_base()
-        {
-            m_first.reserve(16 * 1024);
-        }
+        writer_base() = default;
 
         template<typename... Args>
         void write(std::string_view const& value, Args const&... args)
@@ -26,6 +553,19 @@ namespace pywinrt::text
             write_segment(value, args...);
         }
 
+        template<typename Source, typename... Args>
+        void write(format_string<Source> const&, Args const&... args)
+        {
+            using format = format_string<Source>;
+            static_assert(
+                format::placeholder_count == sizeof...(Args),
+                "The number of arguments doesn't match the format string");
+
+            write_format<format>(
+                std::make_index_sequence<format::segments.size()>{},
+                std::forward_as_tuple(args...));
+        }
+
         template<typename... Args>
         std::string write_temp(std::string_view const& value, Args const&... args)
         {
@@ -35,11 +575,14 @@ namespace pywinrt::text
 #endif
             auto const size = m_first.size();
 
+            // the temporary text must stay in memory until it is removed
+            m_temp_depth++;
             assert(count_placeholders(value) == sizeof...(Args));
             write_segment(value, args...);
 
-            std::string result{m_first.data() + size, m_first.size() - size};
-            m_first.resize(size);
+            std::string result = m_first.substr(size);
+            m_first.truncate(size);
+            m_temp_depth--;
 
 #if defined(XLANG_DEBUG)
             debug_trace = restore_debug_trace;
@@ -49,7 +592,12 @@ namespace pywinrt::text
 
         void write_impl(std::string_view const& value)
         {
-            m_first.insert(m_first.end(), value.begin(), value.end());
+            m_first.append(value);
+
+            if (m_stream)
+            {
+                spill();
+            }
 
 #if defined(XLANG_DEBUG)
             if (debug_trace)
@@ -63,6 +611,11 @@ namespace pywinrt::text
         {
             m_first.push_back(value);
 
+            if (m_stream)
+            {
+                spill();
+            }
+
 #if defined(XLANG_DEBUG)
             if (debug_trace)
             {
@@ -94,29 +647,83 @@ namespace pywinrt::text
 
         void write(int32_t const value)
         {
-            write(std::to_string(value));
+            write_chars<16>(value);
         }
 
         void write(uint32_t const value)
         {
-            write(std::to_string(value));
+            write_chars<16>(value);
         }
 
         void write(int64_t const value)
         {
-            write(std::to_string(value));
+            write_chars<24>(value);
         }
 
         void write(uint64_t const value)
         {
-            write(std::to_string(value));
+            write_chars<24>(value);
+        }
+
+        /**
+         * Writes an unsigned integer in hexadecimal with a 0x prefix, except
+         * for zero, the same as printf's "%#x".
+         */
+        template<typename V, typename = std::enable_if_t<std::is_unsigned_v<V>>>
+        void write_hex(V const value)
+        {
+            if (value == 0)
+            {
+                write('0');
+                return;
+            }
+
+            char buffer[2 + sizeof(V) * 2]{'0', 'x'};
+            auto [end, ec]
+                = std::to_chars(std::begin(buffer) + 2, std::end(buffer), value, 16);
+            assert(ec == std::errc{});
+            write(std::string_view{buffer, static_cast<size_t>(end - buffer)});
+        }
+
+        /**
+         * Writes a floating point number with six decimal places, the same as
+         * printf's "%f".
+         */
+        template<
+            typename V,
+            typename = std::enable_if_t<std::is_floating_point_v<V>>>
+        void write_fixed(V const value)
+        {
+            // large enough for the largest double written without an exponent
+            write_chars<std::numeric_limits<V>::max_exponent10 + 16>(
+                value, std::chars_format::fixed, 6);
         }
 
         template<typename... Args>
         void write_printf(char const* format, Args const&... args)
         {
             char buffer[128];
+#if defined(_MSC_VER)
             size_t const size = sprintf_s(buffer, format, args...);
+#else
+            auto const result = std::snprintf(buffer, sizeof(buffer), format, args...);
+
+            if (result < 0)
+            {
+                return;
+            }
+
+            size_t const size = static_cast<size_t>(result);
+
+            if (size >= sizeof(buffer))
+            {
+                // too long for the buffer, so format it again into one that fits
+                std::string text(size, '\0');
+                std::snprintf(text.data(), size + 1, format, args...);
+                write(text);
+                return;
+            }
+#endif
             write(std::string_view{buffer, size});
         }
 
@@ -131,24 +738,76 @@ namespace pywinrt::text
 
         void swap() noexcept
         {
+            assert(!m_stream); // streamed output can't have text put before it
             std::swap(m_second, m_first);
         }
 
         void flush_to_console() noexcept
         {
-            printf("%.*s", static_cast<int>(m_first.size()), m_first.data());
-            printf("%.*s", static_cast<int>(m_second.size()), m_second.data());
+            for_each_span(
+                [](std::string_view span)
+                {
+                    printf("%.*s", static_cast<int>(span.size()), span.data());
+                });
             m_first.clear();
             m_second.clear();
         }
 
+        /**
+         * Starts sending completed chunks of output to a temporary file next
+         * to filename as they are written, so that the memory used by the
+         * writer doesn't grow with the size of the file. The text written so
+         * far is included. flush_to_file(filename) must be called to move the
+         * temporary file into place; swap() can't be used after this.
+         */
+        void stream_to_file(std::string const& filename)
+        {
+            assert(!m_stream && m_second.empty());
+
+            m_stream = std::make_unique<output_stream>();
+            m_stream->filename = filename;
+            m_stream->temp_filename = filename + ".tmp";
+            m_stream->file.open(
+                m_stream->temp_filename, std::ios::out | std::ios::binary);
+
+            spill();
+        }
+
+        void stream_to_file(std::filesystem::path const& filename)
+        {
+            stream_to_file(filename.string());
+        }
+
         void flush_to_file(std::string const& filename)
         {
-            if (!file_equal(filename))
+            trace_span flush_span{"file", filename};
+
+            if (m_stream)
+            {
+                finish_stream(filename);
+                return;
+            }
+
+            trace_count(
+                trace_recorder::counter::bytes_emitted,
+                m_first.size() + m_second.size());
+
+            if (output_unchanged(filename))
+            {
+                trace_count(trace_recorder::counter::files_unchanged);
+            }
+            else
             {
+                trace_count(trace_recorder::counter::files_written);
+
+                // the chunks are handed to the stream one at a time rather
+                // than being joined into one contiguous buffer first
                 std::ofstream file{filename, std::ios::out | std::ios::binary};
-                file.write(m_first.data(), m_first.size());
-                file.write(m_second.data(), m_second.size());
+                for_each_span(
+                    [&](std::string_view span)
+                    {
+                        file.write(span.data(), span.size());
+                    });
             }
             m_first.clear();
             m_second.clear();
@@ -163,8 +822,11 @@ namespace pywinrt::text
         {
             std::string result;
             result.reserve(m_first.size() + m_second.size());
-            result.assign(m_first.begin(), m_first.end());
-            result.append(m_second.begin(), m_second.end());
+            for_each_span(
+                [&](std::string_view span)
+                {
+                    result.append(span);
+                });
             m_first.clear();
             m_second.clear();
             return result;
@@ -172,7 +834,66 @@ namespace pywinrt::text
 
         char back()
         {
-            return m_first.empty() ? char{} : m_first.back();
+            return m_first.back();
+        }
+
+        /**
+         * Checks if the file already contains the buffered output, using the
+         * recorded digests when available, and records the digest of the new
+         * output.
+         */
+        bool output_unchanged(std::string const& filename) const
+        {
+            if (!digests)
+            {
+                return file_equal(filename);
+            }
+
+            hasher h;
+            for_each_span(
+                [&](std::string_view span)
+                {
+                    h.update(span.data(), span.size());
+                });
+
+            return digest_unchanged(
+                filename,
+                {m_first.size() + m_second.size(), h.finish()},
+                [&]
+                {
+                    return file_equal(filename);
+                });
+        }
+
+        /**
+         * Records the digest of the new output and checks it against the
+         * digest recorded for the existing file, calling contents_equal() when
+         * there is no recorded digest or the digest store is verifying.
+         */
+        template<typename F>
+        static bool digest_unchanged(
+            std::string const& filename,
+            digest_store::digest const& current,
+            F&& contents_equal)
+        {
+            auto previous = digests->find(filename);
+            digests->set(filename, current);
+
+            if (!previous || (*previous == current && digests->verify))
+            {
+                return contents_equal();
+            }
+
+            if (*previous != current)
+            {
+                return false;
+            }
+
+            // the file is not read, but check that it still has the expected
+            // size in case it was deleted or replaced since it was written
+            std::error_code ec;
+            auto size = std::filesystem::file_size(filename, ec);
+            return !ec && size == current.size;
         }
 
         bool file_equal(std::string const& filename) const
@@ -189,22 +910,58 @@ namespace pywinrt::text
                 return false;
             }
 
-            if (!std::equal(
-                    m_first.begin(),
-                    m_first.end(),
-                    file.begin(),
-                    file.begin() + m_first.size()))
+            auto next = file.begin();
+            bool equal{true};
+
+            for_each_span(
+                [&](std::string_view span)
+                {
+                    equal = equal && std::equal(span.begin(), span.end(), next);
+                    next += span.size();
+                });
+
+            return equal;
+        }
+
+        static bool files_equal(std::string const& lhs, std::string const& rhs)
+        {
+            if (!std::filesystem::exists(rhs))
             {
                 return false;
             }
 
-            return std::equal(
-                m_second.begin(),
-                m_second.end(),
-                file.begin() + m_first.size(),
-                file.end());
+            winmd::reader::file_view lhs_file{lhs};
+            winmd::reader::file_view rhs_file{rhs};
+
+            return lhs_file.size() == rhs_file.size()
+                   && std::equal(lhs_file.begin(), lhs_file.end(), rhs_file.begin());
         }
 
+        /**
+         * When set, flush_to_file() uses and updates the recorded digests
+         * instead of always reading back the existing file.
+         */
+        static inline digest_store* digests{};
+
+        /**
+         * Sets digests for the lifetime of the guard.
+         */
+        struct digests_guard
+        {
+            explicit digests_guard(digest_store& store) noexcept
+            {
+                digests = &store;
+            }
+
+            ~digests_guard() noexcept
+            {
+                digests = nullptr;
+            }
+
+            digests_guard(digests_guard const&) = delete;
+            digests_guard& operator=(digests_guard const&) = delete;
+        };
+
 #if defined(XLANG_DEBUG)
         bool debug_trace{};
 #endif
@@ -237,6 +994,45 @@ namespace pywinrt::text
             return count;
         }
 
+        template<size_t Size, typename... Args>
+        void write_chars(Args const... args)
+        {
+            char buffer[Size];
+            auto [end, ec]
+                = std::to_chars(std::begin(buffer), std::end(buffer), args...);
+            assert(ec == std::errc{});
+            write(std::string_view{buffer, static_cast<size_t>(end - buffer)});
+        }
+
+        template<typename Format, size_t... Index, typename Tuple>
+        void write_format(std::index_sequence<Index...>, Tuple const& args)
+        {
+            (write_format_segment<Format, Index>(args), ...);
+        }
+
+        template<typename Format, size_t Index, typename Tuple>
+        void write_format_segment(Tuple const& args)
+        {
+            constexpr auto segment = Format::segments[Index];
+
+            if constexpr (segment.type == format_segment::kind::text)
+            {
+                write(segment.text);
+            }
+            else if constexpr (segment.type == format_segment::kind::value)
+            {
+                static_cast<T*>(this)->write(std::get<segment.arg>(args));
+            }
+            else
+            {
+                using arg_type = std::tuple_element_t<segment.arg, Tuple>;
+                static_assert(
+                    std::is_convertible_v<arg_type, std::string_view>,
+                    "'@' placeholders are only for text");
+                static_cast<T*>(this)->write_code(std::get<segment.arg>(args));
+            }
+        }
+
         void write_segment(std::string_view const& value)
         {
             auto offset = value.find_first_of("^");
@@ -291,8 +1087,101 @@ namespace pywinrt::text
             }
         }
 
-        std::vector<char> m_second;
-        std::vector<char> m_first;
+        /**
+         * Calls f for each chunk of the output: the text written before the
+         * last swap() followed by the text written after it.
+         */
+        template<typename F>
+        void for_each_span(F&& f) const
+        {
+            m_first.for_each_span(f);
+            m_second.for_each_span(f);
+        }
+
+        struct output_stream
+        {
+            std::string filename;
+            std::string temp_filename;
+            std::ofstream file;
+            hasher hash;
+            uint64_t size{};
+
+            void write(std::string_view const& span)
+            {
+                file.write(span.data(), span.size());
+                hash.update(span.data(), span.size());
+                size += span.size();
+            }
+
+            ~output_stream() noexcept
+            {
+                // only left open if the output was abandoned
+                if (file.is_open())
+                {
+                    file.close();
+                    std::error_code ec;
+                    std::filesystem::remove(temp_filename, ec);
+                }
+            }
+        };
+
+        void spill()
+        {
+            if (m_temp_depth == 0 && m_first.chunk_count() > 1)
+            {
+                m_first.drain_full_chunks(
+                    [&](std::string_view span)
+                    {
+                        m_stream->write(span);
+                    });
+            }
+        }
+
+        void finish_stream(std::string const& filename)
+        {
+            assert(m_stream->filename == filename && m_second.empty());
+
+            m_first.for_each_span(
+                [&](std::string_view span)
+                {
+                    m_stream->write(span);
+                });
+            m_first.clear();
+            m_stream->file.close();
+
+            auto stream = std::move(m_stream);
+
+            auto contents_equal = [&]
+            {
+                return files_equal(stream->temp_filename, filename);
+            };
+
+            bool unchanged = digests ? digest_unchanged(
+                                           filename,
+                                           {stream->size, stream->hash.finish()},
+                                           contents_equal)
+                                     : contents_equal();
+
+            trace_count(trace_recorder::counter::bytes_emitted, stream->size);
+
+            if (unchanged)
+            {
+                trace_count(trace_recorder::counter::files_unchanged);
+                std::filesystem::remove(stream->temp_filename);
+            }
+            else
+            {
+                trace_count(trace_recorder::counter::files_written);
+                // replaces the existing file in a single step, so readers
+                // never see a partially written file
+                std::filesystem::rename(stream->temp_filename, filename);
+            }
+        }
+
+        chunked_buffer m_second;
+        chunked_buffer m_first;
+        std::unique_ptr<output_stream> m_stream;
+        uint32_t m_temp_depth{};
     };
 
     template<typename T>
@@ -318,48 +1207,46 @@ namespace pywinrt::text
 
         void write_indent()
         {
-            for (int32_t i = 0; i < m_indent; i++)
+            // indentation is written from a run of spaces, a whole level at
+            // a time, rather than one "    " per level
+            static constexpr std::string_view spaces{
+                "                                                                "};
+
+            for (size_t size = m_indent * size_t{4}; size != 0;)
             {
-                writer_base<T>::write_impl("    ");
+                auto count = std::min(size, spaces.size());
+                writer_base<T>::write_impl(spaces.substr(0, count));
+                size -= count;
             }
         }
 
         void write_impl(std::string_view const& value)
         {
-            std::string_view::size_type current_pos{0};
-            auto on_new_line = writer_base<T>::back() == '\n';
-
-            while (true)
+            if (m_indent == 0)
             {
-                const auto pos = value.find('\n', current_pos);
-
-                if (pos == std::string_view::npos)
-                {
-                    if (current_pos < value.size())
-                    {
-                        if (on_new_line)
-                        {
-                            write_indent();
-                        }
-
-                        writer_base<T>::write_impl(value.substr(current_pos));
-                    }
-
-                    return;
-                }
+                writer_base<T>::write_impl(value);
+                return;
+            }
 
-                auto current_line = value.substr(current_pos, pos - current_pos + 1);
-                auto empty_line = current_line[0] == '\n';
+            auto first = value.data();
+            auto const last = first + value.size();
+            auto on_new_line = writer_base<T>::back() == '\n';
 
-                if (on_new_line && !empty_line)
+            while (first != last)
+            {
+                // empty lines are not indented
+                if (on_new_line && *first != '\n')
                 {
                     write_indent();
                 }
 
-                writer_base<T>::write_impl(current_line);
+                auto newline = find_newline(first, last);
+                on_new_line = newline != last;
+                auto next = on_new_line ? newline + 1 : last;
 
-                on_new_line = true;
-                current_pos = pos + 1;
+                writer_base<T>::write_impl(
+                    std::string_view{first, static_cast<size_t>(next - first)});
+                first = next;
             }
         }
 
@@ -490,3 +1377,21 @@ namespace pywinrt::text
         };
     }
 } // namespace pywinrt::text
+
+/**
+ * Creates a pywinrt::text::format_string from a string literal, so that the
+ * literal is split into text and placeholders at compile time and the number
+ * of arguments passed with it is checked by the compiler.
+ */
+#define PYWINRT_FORMAT(literal)                                                \
+    []                                                                         \
+    {                                                                          \
+        struct source                                                          \
+        {                                                                      \
+            static constexpr std::string_view value()                          \
+            {                                                                  \
+                return literal;                                                \
+            }                                                                  \
+        };                                                                     \
+        return ::pywinrt::text::format_string<source>{};                       \
+    }()
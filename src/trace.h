@@ -0,0 +1,228 @@
+#pragma once
+
+#include "impl/pywinrt_base.h"
+
+namespace pywinrt
+{
+    /**
+     * Records timed spans and counters for the -trace option and saves them in
+     * the Chrome trace event format, which can be opened with chrome://tracing
+     * or https://ui.perfetto.dev.
+     */
+    struct trace_recorder
+    {
+        using clock = std::chrono::high_resolution_clock;
+
+        enum class counter
+        {
+            bytes_emitted,
+            files_written,
+            files_unchanged,
+            chunk_allocations,
+            count
+        };
+
+        /**
+         * The recorder for this run, or null if tracing is off.
+         */
+        static inline trace_recorder* current{};
+
+        trace_recorder() = default;
+        trace_recorder(trace_recorder const&) = delete;
+        trace_recorder& operator=(trace_recorder const&) = delete;
+
+        ~trace_recorder() noexcept
+        {
+            if (current == this)
+            {
+                current = nullptr;
+            }
+        }
+
+        /**
+         * Records a span on the calling thread. The category must be a string
+         * literal. This may be called concurrently.
+         */
+        void add_span(
+            std::string_view const& category,
+            std::string_view const& name,
+            clock::time_point start,
+            clock::time_point end)
+        {
+            span s{
+                std::string{name},
+                category,
+                get_thread_id(),
+                to_microseconds(start),
+                std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+                    .count()};
+
+            std::lock_guard lock{m_lock};
+            m_spans.push_back(std::move(s));
+        }
+
+        void increment(counter c, uint64_t value = 1) noexcept
+        {
+            m_counters[static_cast<size_t>(c)].fetch_add(
+                value, std::memory_order_relaxed);
+        }
+
+        void save(std::filesystem::path const& path) const
+        {
+            static constexpr std::string_view counter_names[]{
+                "bytes emitted",
+                "files written",
+                "files skipped (unchanged)",
+                "writer chunk allocations",
+            };
+
+            static_assert(
+                std::size(counter_names) == static_cast<size_t>(counter::count));
+
+            std::ofstream file{path, std::ios::out | std::ios::binary};
+            file << "{\"traceEvents\":[\n";
+            file << R"({"name":"process_name","ph":"M","pid":1,)"
+                 << R"("args":{"name":"pywinrt"}})";
+
+            for (auto&& s : m_spans)
+            {
+                file << ",\n{\"name\":";
+                write_json_string(file, s.name);
+                file << ",\"cat\":";
+                write_json_string(file, s.category);
+                file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << s.thread
+                     << ",\"ts\":" << s.start << ",\"dur\":" << s.duration << '}';
+            }
+
+            auto end = to_microseconds(clock::now());
+
+            for (size_t i{}; i < std::size(counter_names); i++)
+            {
+                for (auto [ts, value] : {std::pair<int64_t, uint64_t>{0, 0},
+                                         {end, m_counters[i].load()}})
+                {
+                    file << ",\n{\"name\":";
+                    write_json_string(file, counter_names[i]);
+                    file << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << ts
+                         << ",\"args\":{\"value\":" << value << "}}";
+                }
+            }
+
+            file << "\n]}\n";
+        }
+
+      private:
+        struct span
+        {
+            std::string name;
+            std::string_view category;
+            uint32_t thread;
+            int64_t start;
+            int64_t duration;
+        };
+
+        /**
+         * Gets a small number that identifies the calling thread, which is
+         * easier to read in the trace viewer than the OS thread ID.
+         */
+        static uint32_t get_thread_id() noexcept
+        {
+            static std::atomic<uint32_t> next_id{};
+            thread_local uint32_t id{next_id.fetch_add(1)};
+            return id;
+        }
+
+        int64_t to_microseconds(clock::time_point time) const noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(
+                       time - m_start)
+                .count();
+        }
+
+        static void write_json_string(
+            std::ofstream& file, std::string_view const& value)
+        {
+            file << '"';
+
+            for (auto c : value)
+            {
+                if (c == '"' || c == '\\')
+                {
+                    file << '\\' << c;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    file << buffer;
+                }
+                else
+                {
+                    file << c;
+                }
+            }
+
+            file << '"';
+        }
+
+        clock::time_point m_start{clock::now()};
+        std::mutex m_lock;
+        std::vector<span> m_spans;
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(counter::count)>
+            m_counters{};
+    };
+
+    /**
+     * Adds to a counter of the current trace, if any.
+     */
+    inline void trace_count(trace_recorder::counter c, uint64_t value = 1) noexcept
+    {
+        if (auto recorder = trace_recorder::current)
+        {
+            recorder->increment(c, value);
+        }
+    }
+
+    /**
+     * Records a span of the current trace, if any, from construction to
+     * destruction. The category must be a string literal.
+     */
+    struct trace_span
+    {
+        trace_span(std::string_view const& category, std::string_view const& name)
+        {
+            if (trace_recorder::current)
+            {
+                m_category = category;
+                m_name = name;
+                m_start = trace_recorder::clock::now();
+            }
+        }
+
+        trace_span(trace_span const&) = delete;
+        trace_span& operator=(trace_span const&) = delete;
+
+        ~trace_span() noexcept
+        {
+            auto recorder = trace_recorder::current;
+
+            if (recorder && !m_category.empty())
+            {
+                try
+                {
+                    recorder->add_span(
+                        m_category, m_name, m_start, trace_recorder::clock::now());
+                }
+                catch (...)
+                {
+                    // a missing span isn't worth failing the run
+                }
+            }
+        }
+
+      private:
+        std::string_view m_category;
+        std::string m_name;
+        trace_recorder::clock::time_point m_start;
+    };
+} // namespace pywinrt
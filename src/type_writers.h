@@ -30,7 +30,7 @@ namespace pywinrt
         using indented_writer_base<writer>::write;
 
         std::string_view current_namespace{};
-        std::set<std::string> needed_namespaces{};
+        namespace_set needed_namespaces{};
 
 #pragma region generic param handling
         std::vector<std::vector<std::string>> generic_param_stack;
@@ -104,6 +104,48 @@ namespace pywinrt
                 return generic_param_guard{nullptr};
             }
 
+            push_generic_args(type_arguments);
+            return generic_param_guard{this};
+        }
+
+        /**
+         * Restores the generic parameter stack to its current depth when
+         * destroyed.
+         */
+        struct generic_context_guard
+        {
+            explicit generic_context_guard(writer& w) noexcept
+                : owner(w), depth(w.generic_param_stack.size())
+            {
+            }
+
+            ~generic_context_guard()
+            {
+                owner.generic_param_stack.resize(depth);
+            }
+
+            generic_context_guard(generic_context_guard const&) = delete;
+            generic_context_guard& operator=(generic_context_guard const&) = delete;
+
+          private:
+            writer& owner;
+            size_t depth;
+        };
+
+        /**
+         * Pushes the generic arguments recorded for a required type in a
+         * type_member_index. Use a generic_context_guard to pop them.
+         */
+        void push_generic_context(type_member_index::required_type const& required)
+        {
+            for (auto&& type_arguments : required.generic_args)
+            {
+                push_generic_args(type_arguments);
+            }
+        }
+
+        void push_generic_args(std::vector<type_semantics> const& type_arguments)
+        {
             std::vector<std::string> names;
 
             for (auto&& arg : type_arguments)
@@ -113,7 +155,6 @@ namespace pywinrt
             }
 
             generic_param_stack.push_back(std::move(names));
-            return generic_param_guard{this};
         }
 
 #pragma endregion
@@ -125,61 +166,62 @@ namespace pywinrt
 
         void write_value(char16_t value)
         {
-            write_printf("%#0hx", value);
+            write_hex(static_cast<uint16_t>(value));
         }
 
         void write_value(int8_t value)
         {
-            write_printf("%hhd", value);
+            write(static_cast<int32_t>(value));
         }
 
         void write_value(uint8_t value)
         {
-            write_printf("%#0hhx", value);
+            write_hex(value);
         }
 
         void write_value(int16_t value)
         {
-            write_printf("%hd", value);
+            write(static_cast<int32_t>(value));
         }
 
         void write_value(uint16_t value)
         {
-            write_printf("%#0hx", value);
+            write_hex(value);
         }
 
         void write_value(int32_t value)
         {
-            write_printf("%d", value);
+            write(value);
         }
 
         void write_value(uint32_t value)
         {
-            write_printf("%#0x", value);
+            write_hex(value);
         }
 
         void write_value(int64_t value)
         {
-            write_printf("%lld", value);
+            write(value);
         }
 
         void write_value(uint64_t value)
         {
-            write_printf("%#0llx", value);
+            write_hex(value);
         }
 
         void write_value(float value)
         {
-            write_printf("%f", value);
+            write_fixed(value);
         }
 
         void write_value(double value)
         {
-            write_printf("%f", value);
+            write_fixed(value);
         }
 
         void write_value(std::u16string_view value)
         {
+#if defined(_WIN32)
             static_assert(sizeof(std::u16string_view::value_type) == sizeof(WCHAR));
             static_assert(sizeof(std::string_view::value_type) == sizeof(CHAR));
 
@@ -224,6 +266,47 @@ namespace pywinrt
             }
 
             std::string_view converted_value{buffer.get()};
+#else
+            std::string converted_value;
+
+            for (size_t i{}; i < value.size(); i++)
+            {
+                uint32_t c = value[i];
+
+                if (c >= 0xd800 && c <= 0xdbff && i + 1 < value.size()
+                    && value[i + 1] >= 0xdc00 && value[i + 1] <= 0xdfff)
+                {
+                    c = 0x10000 + ((c - 0xd800) << 10) + (value[++i] - 0xdc00);
+                }
+                else if (c >= 0xd800 && c <= 0xdfff)
+                {
+                    throw_invalid("Untranslatable string");
+                }
+
+                if (c < 0x80)
+                {
+                    converted_value += static_cast<char>(c);
+                }
+                else if (c < 0x800)
+                {
+                    converted_value += static_cast<char>(0xc0 | (c >> 6));
+                    converted_value += static_cast<char>(0x80 | (c & 0x3f));
+                }
+                else if (c < 0x10000)
+                {
+                    converted_value += static_cast<char>(0xe0 | (c >> 12));
+                    converted_value += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+                    converted_value += static_cast<char>(0x80 | (c & 0x3f));
+                }
+                else
+                {
+                    converted_value += static_cast<char>(0xf0 | (c >> 18));
+                    converted_value += static_cast<char>(0x80 | ((c >> 12) & 0x3f));
+                    converted_value += static_cast<char>(0x80 | ((c >> 6) & 0x3f));
+                    converted_value += static_cast<char>(0x80 | (c & 0x3f));
+                }
+            }
+#endif
 
             write("\"%\"", converted_value);
         }
@@ -330,7 +413,7 @@ namespace pywinrt
         {
             if (ns != current_namespace && ns != "System")
             {
-                needed_namespaces.emplace(ns);
+                needed_namespaces.insert(ns);
             }
         }
 
@@ -394,7 +477,7 @@ namespace pywinrt
 
             if (ns != current_namespace)
             {
-                needed_namespaces.emplace(ns);
+                needed_namespaces.insert(ns);
             }
 
             if ((ns == "Windows.Foundation") && (name == "HResult"))
@@ -894,49 +977,47 @@ namespace pywinrt
         }
     };
 
-    template<typename F>
-    void enumerate_required_types(writer& w, TypeDef const& type, F func)
+    /**
+     * Calls @p func for each member of a type_member_index in order, with the
+     * generic parameter context of the required type that declares it.
+     */
+    template<typename Members, typename F>
+    void enumerate_indexed_members(
+        writer& w,
+        type_member_index const& index,
+        Members const& members,
+        F&& func)
     {
-        std::set<TypeDef> types;
+        std::optional<writer::generic_context_guard> context;
+        auto current = index.required_types.size();
 
-        auto enumerate_types_impl
-            = [&](type_semantics const& semantics, auto const& lambda) -> void
+        for (auto&& member : members)
         {
-            auto type = get_typedef(semantics);
-            auto generic_args = std::visit(
-                impl::overloaded{
-                    [](type_definition) -> std::vector<type_semantics>
-                    {
-                        return {};
-                    },
-                    [](generic_type_instance type_instance)
-                    {
-                        return type_instance.generic_args;
-                    },
-                    [](auto) -> std::vector<type_semantics>
-                    {
-                        throw_invalid("type doesn't contain typedef");
-                    }},
-                semantics);
-
-            auto guard{w.push_generic_params(generic_args)};
-
-            if (!contains(types, type))
+            if (member.required_index != current)
             {
-                types.insert(type);
-                func(type);
+                context.reset();
+                context.emplace(w);
+                current = member.required_index;
+                w.push_generic_context(index.required_types[current]);
             }
 
-            if (get_category(type) == category::interface_type)
-            {
-                for (auto&& ii : type.InterfaceImpl())
-                {
-                    lambda(get_type_semantics(ii.Interface()), lambda);
-                }
-            }
-        };
+            func(member);
+        }
+    }
 
-        enumerate_types_impl(type, enumerate_types_impl);
+    /**
+     * Calls @p func on @p type and each interface it requires (directly or
+     * indirectly), once per type.
+     */
+    template<typename F>
+    void enumerate_required_types(writer& w, TypeDef const& type, F func)
+    {
+        for (auto&& required : get_member_index(type).required_types)
+        {
+            writer::generic_context_guard context{w};
+            w.push_generic_context(required);
+            func(required.type);
+        }
     }
 
     /**
@@ -944,90 +1025,46 @@ namespace pywinrt
      *
      * @param [in]  w       A writer.
      * @param [in]  type    The type that contains the methods.
-     * @param [in]  func    A function that takes two args, the MethodDef and
-     *                      a boolean indicating if the method is overloaded.
+     * @param [in]  func    A function that takes the MethodDef. Overloads
+     *                      with the same name are passed one after another.
      */
     template<typename F>
     void enumerate_methods(writer& w, TypeDef const& type, F func)
     {
-        std::set<std::string_view> method_names{};
-
-        // collect all unique method names
+        auto const& index = get_member_index(type);
 
-        enumerate_required_types(
-            w,
-            type,
-            [&](TypeDef const& required_type)
-            {
-                for (auto&& method : required_type.MethodList())
+        for (auto&& group : index.methods)
+        {
+            enumerate_indexed_members(
+                w,
+                index,
+                group.overloads,
+                [&](type_member_index::method_overload const& overload)
                 {
-                    if (method.SpecialName())
-                    {
-                        // skip .ctor, get_/put_ and add_/remove_ methods
-                        continue;
-                    }
-
-                    method_names.insert(method.Name());
-                }
-            });
+                    func(overload.method);
+                });
+        }
+    }
 
-        // call callback for each method with overloads grouped together
-        // REVISIT: this doesn't handle the case if an interface has an overload
-        // with the same number of parameters as a required interface
+    /**
+     * Calls @p func on the methods in @p type named @p name, the same as
+     * enumerate_methods() filtered by name.
+     */
+    template<typename F>
+    void enumerate_method_overloads(
+        writer& w, TypeDef const& type, std::string_view const& name, F func)
+    {
+        auto const& index = get_member_index(type);
 
-        for (auto&& method_name : method_names)
+        if (auto group = index.find_method_group(name))
         {
-            enumerate_required_types(
+            enumerate_indexed_members(
                 w,
-                type,
-                [&](TypeDef const& required_type)
+                index,
+                group->overloads,
+                [&](type_member_index::method_overload const& overload)
                 {
-                    // map of overloads by number of parameters
-                    std::map<int, std::vector<MethodDef>> overloads;
-
-                    for (auto&& method : required_type.MethodList())
-                    {
-                        if (method.Name() != method_name)
-                        {
-                            continue;
-                        }
-
-                        method_signature signature{method};
-                        auto arg_count = count_py_in_param(signature.params());
-                        overloads[arg_count].push_back(method);
-                    }
-
-                    for (auto o : overloads)
-                    {
-                        // if there are multiple overloads with the same number of
-                        // arguments, we need to use the default overload
-                        // https://devblogs.microsoft.com/oldnewthing/20210528-00/?p=105259
-                        auto default_overload = std::find_if(
-                            o.second.begin(),
-                            o.second.end(),
-                            [](auto m)
-                            {
-                                for (auto a : m.CustomAttribute())
-                                {
-                                    if (a.TypeNamespaceAndName().second
-                                        == "DefaultOverloadAttribute")
-                                    {
-                                        return true;
-                                    }
-                                }
-
-                                return false;
-                            });
-
-                        // if there was no default, just use the first (and
-                        // hopefully only) overload
-                        auto i
-                            = default_overload == o.second.end()
-                                  ? 0
-                                  : std::distance(o.second.begin(), default_overload);
-
-                        func(o.second.at(i));
-                    }
+                    func(overload.method);
                 });
         }
     }
@@ -1035,30 +1072,30 @@ namespace pywinrt
     template<typename F>
     void enumerate_properties(writer& w, TypeDef const& type, F func)
     {
-        enumerate_required_types(
+        auto const& index = get_member_index(type);
+
+        enumerate_indexed_members(
             w,
-            type,
-            [&](TypeDef const& required_type)
+            index,
+            index.properties,
+            [&](type_member_index::member<Property> const& prop)
             {
-                for (auto&& prop : required_type.PropertyList())
-                {
-                    func(prop);
-                }
+                func(prop.value);
             });
     }
 
     template<typename F>
     void enumerate_events(writer& w, TypeDef const& type, F func)
     {
-        enumerate_required_types(
+        auto const& index = get_member_index(type);
+
+        enumerate_indexed_members(
             w,
-            type,
-            [&](TypeDef const& required_type)
+            index,
+            index.events,
+            [&](type_member_index::member<Event> const& evt)
             {
-                for (auto&& evt : required_type.EventList())
-                {
-                    func(evt);
-                }
+                func(evt.value);
             });
     }
 
@@ -1089,18 +1126,9 @@ namespace pywinrt
                     return method.Name() == ".ctor";
                 });
         }
-        else
+        else if (auto group = get_member_index(type).find_method_group(name))
         {
-            enumerate_methods(
-                w,
-                type,
-                [&](MethodDef const& method)
-                {
-                    if (method.Name() == name)
-                    {
-                        count++;
-                    }
-                });
+            count = static_cast<int>(group->overloads.size());
         }
 
         return count > 1;